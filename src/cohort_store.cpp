@@ -0,0 +1,171 @@
+#include "cohort_store.h"
+#include "paralelo.h"
+#include <QDebug>
+#include <algorithm>
+#include <functional>
+#include <numeric>
+#include <queue>
+
+// ************************************************************************************************
+void cohorte_metilacion::construye(const vector<const muestra_metilacion *> &seleccion, bool hmC, double cobertura_minima, unsigned hilos)
+{
+    clear();
+
+    // posiciones de cada muestra que superan la cobertura mínima, con su proporción
+    vector<vector<uint32_t>> filtradas(seleccion.size());
+    vector<vector<float>>    valores(seleccion.size());
+
+    // posiciones de cada muestra que estaban fuera de orden y repetidas que se han fusionado
+    vector<size_t> desordenadas(seleccion.size(), 0);
+    vector<size_t> repetidas(seleccion.size(), 0);
+
+    reparte_hilos(seleccion.size(), hilos, [&](size_t ini, size_t fin, unsigned)
+    {
+        for (size_t s = ini; s < fin; s++)
+        {
+            vector<uint32_t> &f = filtradas[s];
+            vector<float>    &v = valores[s];
+
+            seleccion[s]->recorre_bloques([&](const columnas_mapa &tramo, size_t)
+            {
+                for (size_t k = 0; k < tramo.size(); k++)
+                    if (muestra_metilacion::cobertura(tramo, k, hmC) >= cobertura_minima)
+                    {
+                        f.push_back(tramo.posicion[k]);
+                        v.push_back(float(muestra_metilacion::ratio(tramo, k, hmC)));
+                    }
+            });
+
+            // la presencia y la fila de la matriz necesitan posiciones estrictamente crecientes:
+            // las que llegan fuera de orden se ordenan junto con su proporción (orden estable)
+            for (size_t k = 1; k < f.size(); k++)
+                if (f[k] < f[k - 1])
+                    desordenadas[s]++;
+
+            if (desordenadas[s] > 0)
+            {
+                vector<size_t> orden(f.size());
+                iota(orden.begin(), orden.end(), size_t(0));
+                stable_sort(orden.begin(), orden.end(), [&](size_t a, size_t b) { return f[a] < f[b]; });
+
+                vector<uint32_t> fo(f.size());
+                vector<float>    vo(v.size());
+                for (size_t k = 0; k < orden.size(); k++)
+                {
+                    fo[k] = f[orden[k]];
+                    vo[k] = v[orden[k]];
+                }
+                f.swap(fo);
+                v.swap(vo);
+            }
+
+            // una posición repetida se fusiona en una sola con el último valor leído, el mismo
+            // que quedaba al rellenar la matriz completa de la muestra
+            size_t escritas = 0;
+            for (size_t k = 0; k < f.size(); k++)
+            {
+                if (escritas > 0 && f[escritas - 1] == f[k])
+                    escritas--;
+                f[escritas] = f[k];
+                v[escritas] = v[k];
+                escritas++;
+            }
+            repetidas[s] = f.size() - escritas;
+            f.resize(escritas);
+            v.resize(escritas);
+        }
+    });
+
+    for (size_t s = 0; s < seleccion.size(); s++)
+        if (desordenadas[s] > 0 || repetidas[s] > 0)
+            qDebug() << "muestra" << seleccion[s]->muestra << (seleccion[s]->grupo == 0 ? "(caso)" : "(control)")
+                     << "cromosoma" << seleccion[s]->cromosoma << ":" << desordenadas[s] << "posiciones fuera de orden reordenadas,"
+                     << repetidas[s] << "posiciones repetidas fusionadas";
+
+    // unión ordenada de las posiciones de todas las muestras: mezcla de k vías con un montículo de
+    // la siguiente posición de cada muestra, O(total · log muestras)
+    typedef pair<uint32_t, size_t> cabeza;
+    priority_queue<cabeza, vector<cabeza>, greater<cabeza>> frente;
+    vector<size_t> cursor(filtradas.size(), 0);
+    for (size_t s = 0; s < filtradas.size(); s++)
+        if (!filtradas[s].empty())
+            frente.push(cabeza(filtradas[s][0], s));
+
+    while (!frente.empty())
+    {
+        cabeza c = frente.top();
+        frente.pop();
+        if (posiciones.empty() || posiciones.back() != c.first)
+            posiciones.push_back(c.first);
+        if (++cursor[c.second] < filtradas[c.second].size())
+            frente.push(cabeza(filtradas[c.second][cursor[c.second]], c.second));
+    }
+    posiciones.shrink_to_fit();
+
+    // inicio de cada fila de la matriz dispersa
+    matriz.fila.assign(seleccion.size() + 1, 0);
+    for (size_t s = 0; s < seleccion.size(); s++)
+        matriz.fila[s + 1] = matriz.fila[s] + filtradas[s].size();
+    matriz.columna.resize(matriz.fila.back());
+    matriz.valor.resize(matriz.fila.back());
+    matriz.origen = 0;
+
+    // presencia de cada muestra alineada con el diccionario y valores en su fila de la matriz
+    size_t palabras = (posiciones.size() + 63) / 64;
+    muestras.resize(seleccion.size());
+
+    reparte_hilos(seleccion.size(), hilos, [&](size_t ini, size_t fin, unsigned)
+    {
+        for (size_t s = ini; s < fin; s++)
+        {
+            muestra_cohorte &m = muestras[s];
+            m.presencia.assign(palabras, 0);
+            m.acumulado.assign(palabras, 0);
+
+            size_t i = 0;
+            for (size_t k = 0; k < filtradas[s].size(); k++)
+            {
+                while (i < posiciones.size() && posiciones[i] < filtradas[s][k])
+                    i++;
+                m.presencia[i >> 6] |= uint64_t(1) << (i & 63);
+                m.ultimo = i;
+            }
+            m.sitios = filtradas[s].size();
+
+            uint32_t total = 0;
+            for (size_t w = 0; w < palabras; w++)
+            {
+                m.acumulado[w] = total;
+                total += uint32_t(__builtin_popcountll(m.presencia[w]));
+            }
+
+            copy(filtradas[s].begin(), filtradas[s].end(), matriz.columna.begin() + long(matriz.fila[s]));
+            copy(valores[s].begin(),   valores[s].end(),   matriz.valor.begin()   + long(matriz.fila[s]));
+
+            vector<uint32_t>().swap(filtradas[s]);
+            vector<float>().swap(valores[s]);
+        }
+    });
+}
+
+// ************************************************************************************************
+size_t cohorte_metilacion::busca(uint32_t posicion) const
+{
+    return size_t(lower_bound(posiciones.begin(), posiciones.end(), posicion) - posiciones.begin());
+}
+
+// ************************************************************************************************
+size_t cohorte_metilacion::busca_posterior(uint32_t posicion) const
+{
+    return size_t(upper_bound(posiciones.begin(), posiciones.end(), posicion) - posiciones.begin());
+}
+
+// ************************************************************************************************
+size_t cohorte_metilacion::bytes() const
+{
+    size_t total = posiciones.size() * sizeof(uint32_t);
+    for (const auto &m : muestras)
+        total += m.presencia.size() * sizeof(uint64_t) + m.acumulado.size() * sizeof(uint32_t);
+
+    return total + matriz.bytes();
+}
@@ -0,0 +1,108 @@
+#ifndef COHORT_STORE_H
+#define COHORT_STORE_H
+
+#include "sample_store.h"
+#include "data_pack.h"
+
+/** ***********************************************************************************************
+  *  \brief sitios de una muestra alineados con el diccionario de posiciones de la cohorte
+  *  \param presencia   bit i activo si la muestra tiene la posición i del diccionario
+  *  \param acumulado   número de bits activos antes de cada palabra de presencia
+  *  \param sitios      número de posiciones presentes en la muestra
+  *  \param ultimo      índice en el diccionario de la última posición presente (si sitios > 0)
+  * ***********************************************************************************************
+  */
+struct muestra_cohorte
+{
+    vector<uint64_t> presencia;
+    vector<uint32_t> acumulado;
+    size_t           sitios = 0;
+    size_t           ultimo = 0;
+
+    bool presente(size_t i) const { return (presencia[i >> 6] >> (i & 63)) & 1; }
+
+    // número de posiciones presentes con índice menor que i en el diccionario
+    size_t rango(size_t i) const
+    {
+        size_t   palabra = i >> 6;
+        unsigned bit     = unsigned(i & 63);
+
+        if (palabra >= presencia.size())
+            return sitios;
+        if (bit == 0)
+            return acumulado[palabra];
+
+        return acumulado[palabra] + size_t(__builtin_popcountll(presencia[palabra] << (64 - bit)));
+    }
+
+    // número de posiciones presentes con índice en [desde, hasta) del diccionario
+    size_t cuenta(size_t desde, size_t hasta) const { return (hasta > desde) ? rango(hasta) - rango(desde) : 0; }
+
+    /** ***********************************************************************************************
+      * \fn void recorre(F)
+      *  \brief Llama a f(i) con el índice en el diccionario de cada posición presente, en orden
+      * ***********************************************************************************************
+      */
+    template <class F>
+    void recorre(F f) const
+    {
+        for (size_t w = 0; w < presencia.size(); w++)
+        {
+            uint64_t palabra = presencia[w];
+            while (palabra)
+            {
+                f((w << 6) + size_t(__builtin_ctzll(palabra)));
+                palabra &= palabra - 1;
+            }
+        }
+    }
+};
+
+/** ***********************************************************************************************
+  *  \brief posiciones de las muestras seleccionadas para el análisis de un cromosoma: una sola
+  *         copia ordenada de la unión de las posiciones que superan la cobertura mínima en
+  *         alguna muestra, y por cada muestra su mapa de presencia, de modo que las operaciones
+  *         entre muestras recorren índices comunes. Los valores se guardan en una matriz dispersa
+  *         por filas (una por muestra) en el mismo orden que los bits activos de la presencia,
+  *         por lo que el valor de la posición i del diccionario está en fila[s] + rango(i)
+  *  \param posiciones  unión ordenada de posiciones de la cohorte
+  *  \param muestras    sitios de cada muestra seleccionada, en el orden de selección
+  *  \param matriz      proporción de metilación de cada posición presente en cada muestra
+  * ***********************************************************************************************
+  */
+struct cohorte_metilacion
+{
+    vector<uint32_t>        posiciones;
+    vector<muestra_cohorte> muestras;
+    matriz_dispersa         matriz;
+
+    /** ***********************************************************************************************
+      * \fn void construye(const vector<const muestra_metilacion *> &, bool, double, unsigned)
+      *  \brief Construye el diccionario y los mapas de presencia de las muestras seleccionadas
+      *         con las posiciones cuya cobertura alcanza la mínima; en cada muestra se ordenan las
+      *         posiciones que llegan fuera de orden y las repetidas se fusionan con el último valor
+      *         leído, avisando con qDebug de cuántas se han tratado
+      *  \param &seleccion          muestras a incluir, en el orden en que se analizan
+      *  \param hmC                 tipo de análisis: mC (false) o hmC (true)
+      *  \param cobertura_minima    cobertura mínima de una posición para incluirla
+      *  \param hilos               número de hilos a utilizar
+      * ***********************************************************************************************
+      */
+    void construye(const vector<const muestra_metilacion *> &seleccion, bool hmC, double cobertura_minima, unsigned hilos);
+
+    void clear() { vector<uint32_t>().swap(posiciones); vector<muestra_cohorte>().swap(muestras); matriz = matriz_dispersa(); }
+
+    // valor de la muestra s en la posición i del diccionario (0 si no está presente)
+    float valor(size_t s, size_t i) const
+    {
+        return muestras[s].presente(i) ? matriz.valor[matriz.fila[s] + muestras[s].rango(i)] : 0.0f;
+    }
+
+    // índice del primer elemento del diccionario con posición mayor o igual / mayor que 'posicion'
+    size_t busca(uint32_t posicion) const;
+    size_t busca_posterior(uint32_t posicion) const;
+
+    size_t bytes() const;
+};
+
+#endif // COHORT_STORE_H
@@ -2,15 +2,88 @@
 #define DATA_PACK_H
 
 #include <deque>
+#include <vector>
 #include <string>
+#include <chrono>
+#include <cstdint>
 
 using namespace std;
 
+// temporizadores para control de tiempos de los procesos de análisis y lectura
+#define TIMING
+
+// compara en cada análisis DMR la disposición por bloques con la de una fila por muestra (copia la
+// matriz y repite el cálculo: solo para medir, requiere TIMING)
+//#define BENCHMARK_DMR
+
+#ifdef TIMING
+#define INIT_TIMER        auto start = std::chrono::high_resolution_clock::now();
+#define START_TIMER       start = std::chrono::high_resolution_clock::now();
+#define STOP_TIMER(name)  qDebug() << "DURACION de " << name << ": " << \
+                          std::chrono::duration_cast<std::chrono::milliseconds>( \
+                          std::chrono::high_resolution_clock::now()-start \
+                          ).count() << " ms ";
+#define STOP_TIMER_MBS(name, bytes) \
+                          qDebug() << "VELOCIDAD de " << name << ": " << \
+                          (double(bytes) / (1024.0 * 1024.0)) / \
+                          (std::chrono::duration_cast<std::chrono::microseconds>( \
+                          std::chrono::high_resolution_clock::now()-start \
+                          ).count() * 1e-6 + 1e-9) << " MB/s ";
+#else
+#define INIT_TIMER
+#define START_TIMER
+#define STOP_TIMER(name)
+#define STOP_TIMER_MBS(name, bytes)
+#endif
+
+// escalado de la gráfica de la transformada
+#define AJUSTE_PLOT 1.70        // ajusta eje Y de gráfica a AJUSTE_PLOT
+#define DESPLAZAMIENTO_DIBUJO 0.98
+
+// matriz dispersa por filas: fila = muestra, columna = posición del cromosoma
+// la columna guarda la posición y no su índice en el diccionario de la cohorte para que los motores
+// (y el núcleo csr2full de la GPU) rellenen la matriz completa sin consultar el diccionario; a cambio,
+// cada posición que supera la cobertura queda en la fila de su muestra además de en la columna de
+// posiciones de la muestra cargada (necesaria para los listados y el detalle) y en la unión de la cohorte
+struct matriz_dispersa
+{
+    vector<size_t>   fila;      // inicio de cada fila en columna y valor; fila[muestras] = total de datos
+    vector<uint32_t> columna;   // posición en el cromosoma de cada dato, ordenada dentro de cada fila
+    vector<float>    valor;     // valor de cada dato
+    uint32_t         origen;    // posición del cromosoma que corresponde a la columna 0 de la matriz completa
+
+    size_t filas() const { return fila.empty() ? 0 : fila.size() - 1; }
+    size_t bytes() const { return fila.size() * sizeof(size_t) + columna.size() * (sizeof(uint32_t) + sizeof(float)); }
+};
+
+// contadores de un espacio de trabajo reutilizado entre transformadas (para perfilado)
+struct contadores_espacio
+{
+    size_t reservas;            // veces que se ha tenido que reservar (hacer crecer) la memoria
+    size_t reutilizaciones;     // veces que ha bastado la memoria ya reservada
+    size_t bytes;               // tamaño máximo reservado (marca de agua) en bytes
+};
+
+// memoria temporal de la GPU para las transformadas: crece hasta el máximo que se ha necesitado
+// y se reutiliza en cada llamada hasta que se libera con cuda_end
+struct espacio_gpu
+{
+    float      *d_temp;         // cálculos intermedios de wavedec
+    size_t     pitch;           // desplazamiento entre filas de d_temp
+    size_t     ancho;           // bytes por fila reservados en d_temp
+    int        filas;           // filas reservadas en d_temp
+    float      *d_plot;         // gráfica de las teselas (no se dibuja)
+    size_t     plot;            // floats reservados en d_plot
+    size_t     *d_rango;        // límites de cada muestra dentro de la tesela
+    size_t     rango;           // elementos reservados en d_rango
+    contadores_espacio contadores;
+};
+
 // estructura de datos para transferir entre visualizador, controlador y GPU.
 
 struct datos_cuda
 {
-    float      **mc_full;       // matriz de datos completos de todas las muestras
+    const matriz_dispersa *mc_csr;  // matriz dispersa de todas las muestras
     float      **h_haar_C;      // matriz de datos procesados en GPU
     deque<int> h_haar_L;        // vector con número de datos por nivel
     float      *d_haar;         // vector de datos en GPU
@@ -26,6 +99,11 @@ struct datos_cuda
     void       *d_glPtr;        // puntero a array de datos para visualización directa opengl desde gpu
     string     **refGen;        // matriz de referencias cromosómicas del cromosoma analizado
     float      *d_max;          // vector con el valor máximo a dibujar en la posición [0]
+    vector<float> h_plot;       // vértices de la gráfica calculados en CPU (vacío si se dibuja desde la GPU)
+    size_t     ancho_tesela;    // columnas por tesela en GPU (0 si la matriz completa cabe en GPU)
+    uint32_t   *d_columna;      // columnas de la matriz dispersa residente en GPU en el modo por teselas
+    float      *d_valor;        // valores de la matriz dispersa residente en GPU en el modo por teselas
+    espacio_gpu espacio;        // memoria temporal de la GPU reutilizada entre transformadas
 };
 
 #endif // DATA_PACK_H
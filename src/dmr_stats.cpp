@@ -0,0 +1,212 @@
+#include "dmr_stats.h"
+#include "haar_simd.h"
+#include "paralelo.h"
+#include <algorithm>
+#include <cmath>
+
+// ************************************************************************************************
+void matriz_bloques::construye(const vector<vector<float>> &filas, size_t regiones, unsigned hilos)
+{
+    clear();
+    this->muestras = filas.size();
+    this->regiones = regiones;
+
+    // holgura de una línea de caché para que el primer bloque (y con él todos, de 4 KB por
+    // muestra) empiece alineado a 64 bytes
+    datos.resize(bloques() * muestras * BLOQUE_DMR + 16);
+    inicio = ((64 - reinterpret_cast<uintptr_t>(datos.data()) % 64) % 64) / sizeof(float);
+
+    reparte_hilos(bloques(), hilos, [&](size_t primero, size_t ultimo, unsigned)
+    {
+        for (size_t b = primero; b < ultimo; b++)
+            for (size_t s = 0; s < muestras; s++)
+            {
+                size_t desde = b * BLOQUE_DMR;
+                size_t hasta = min(regiones, min(filas[s].size(), desde + BLOQUE_DMR));
+                if (desde < hasta)
+                    copy(filas[s].begin() + long(desde), filas[s].begin() + long(hasta), bloque(b, s));
+            }
+    });
+}
+
+// ************************************************************************************************
+vector<vector<float>> matriz_bloques::filas() const
+{
+    vector<vector<float>> salida(muestras, vector<float>(regiones));
+    for (size_t s = 0; s < muestras; s++)
+        for (size_t b = 0; b < bloques(); b++)
+        {
+            size_t desde = b * BLOQUE_DMR;
+            size_t hasta = min(regiones, desde + BLOQUE_DMR);
+            copy(bloque(b, s), bloque(b, s) + (hasta - desde), salida[s].begin() + long(desde));
+        }
+
+    return salida;
+}
+
+// ************************************************************************************************
+// recorrido común a las dos disposiciones: fila(b, s) da los coeficientes de la muestra s en el bloque b
+template <class F>
+static void diferencia_bloques(F fila, size_t muestras, size_t regiones, const cohorte_metilacion &cohorte,
+                               const vector<int> &grupo, const criterio_dmr &criterio, float *diferencia,
+                               estadistica_dmr *estadistica, unsigned hilos)
+{
+    const vector<uint32_t> &posiciones = cohorte.posiciones;
+    size_t bloques = (regiones + BLOQUE_DMR - 1) / BLOQUE_DMR;
+
+    muestras = min(muestras, min(cohorte.muestras.size(), grupo.size()));
+    if (estadistica != nullptr)
+        estadistica->resize(regiones);
+
+    reparte_hilos(bloques, hilos, [&](size_t primero, size_t ultimo, unsigned)
+    {
+        vector<size_t>   desde(BLOQUE_DMR);
+        vector<size_t>   hasta(BLOQUE_DMR);
+        vector<uint32_t> sitios(BLOQUE_DMR);
+        vector<float>    suma_casos(BLOQUE_DMR);
+        vector<float>    suma_control(BLOQUE_DMR);
+        vector<float>    desviacion_casos(BLOQUE_DMR);
+        vector<float>    desviacion_control(BLOQUE_DMR);
+        vector<uint32_t> numero_casos(BLOQUE_DMR);
+        vector<uint32_t> numero_control(BLOQUE_DMR);
+
+        for (size_t b = primero; b < ultimo; b++)
+        {
+            uint32_t inicio = uint32_t(b * BLOQUE_DMR);
+            size_t   n      = min(size_t(BLOQUE_DMR), regiones - inicio);
+
+            // tramo [desde, hasta) del diccionario de cada región, común a todas las muestras: se
+            // parte de una cota inferior y se avanza como en el recorrido serie, con la misma
+            // aritmética sin signo de 32 bits
+            size_t d = size_t(lower_bound(posiciones.begin(), posiciones.end(), criterio.origen + inicio * criterio.paso) - posiciones.begin());
+            size_t h = d;
+            for (size_t k = 0; k < n; k++)
+            {
+                uint32_t m = inicio + uint32_t(k);
+                while (d < posiciones.size() && posiciones[d] - criterio.origen <= m * criterio.paso)
+                    d++;
+                if (h < d)
+                    h = d;
+                while (h < posiciones.size() && posiciones[h] - criterio.origen < (m + 1) * criterio.paso)
+                    h++;
+
+                desde[k] = d;
+                hasta[k] = h;
+            }
+
+            fill(suma_casos.begin(),         suma_casos.begin() + n,         0.0f);
+            fill(suma_control.begin(),       suma_control.begin() + n,       0.0f);
+            fill(desviacion_casos.begin(),   desviacion_casos.begin() + n,   0.0f);
+            fill(desviacion_control.begin(), desviacion_control.begin() + n, 0.0f);
+            fill(numero_casos.begin(),       numero_casos.begin() + n,       0u);
+            fill(numero_control.begin(),     numero_control.begin() + n,     0u);
+
+            for (size_t s = 0; s < muestras; s++)
+            {
+                const muestra_cohorte &muestra = cohorte.muestras[s];
+
+                // posiciones de la muestra en cada región por popcount sobre su mapa de presencia
+                sitios_regiones(muestra.presencia.data(), muestra.acumulado.data(), desde.data(), hasta.data(),
+                                n, muestra.ultimo, sitios.data());
+
+                if (grupo[s] == 0)
+                    acumula_region(fila(b, s), sitios.data(), n, criterio.minimo_sitios,
+                                   suma_control.data(), desviacion_control.data(), numero_control.data());
+                else
+                    acumula_region(fila(b, s), sitios.data(), n, criterio.minimo_sitios,
+                                   suma_casos.data(), desviacion_casos.data(), numero_casos.data());
+            }
+
+            for (size_t k = 0; k < n; k++)
+                if (numero_casos[k] >= criterio.minimo_casos && numero_control[k] >= criterio.minimo_control)
+                    diferencia[inicio + k] = (suma_casos[k] / numero_casos[k]) - (suma_control[k] / numero_control[k]);
+                else
+                    diferencia[inicio + k] = 0.0f;
+
+            if (estadistica == nullptr)
+                continue;
+
+            for (size_t k = 0; k < n; k++)
+            {
+                size_t m  = inicio + k;
+                float  vk = (numero_casos[k]   > 1) ? desviacion_casos[k]   / float(numero_casos[k] - 1)   : 0.0f;
+                float  vc = (numero_control[k] > 1) ? desviacion_control[k] / float(numero_control[k] - 1) : 0.0f;
+
+                // error típico de la diferencia con varianzas distintas (Welch)
+                float error = (numero_casos[k] > 1 && numero_control[k] > 1) ?
+                              sqrt(vk / float(numero_casos[k]) + vc / float(numero_control[k])) : 0.0f;
+
+                estadistica->casos[m]            = numero_casos[k];
+                estadistica->control[m]          = numero_control[k];
+                estadistica->varianza_casos[m]   = vk;
+                estadistica->varianza_control[m] = vc;
+                estadistica->t[m]                = (error > 0.0f) ? diferencia[m] / error : 0.0f;
+            }
+        }
+    });
+}
+
+// ************************************************************************************************
+void diferencia_grupos(const matriz_bloques &coeficientes, const cohorte_metilacion &cohorte,
+                       const vector<int> &grupo, const criterio_dmr &criterio, float *diferencia,
+                       estadistica_dmr *estadistica, unsigned hilos)
+{
+    diferencia_bloques([&](size_t b, size_t s) { return coeficientes.bloque(b, s); },
+                       coeficientes.muestras, coeficientes.regiones, cohorte, grupo, criterio, diferencia, estadistica, hilos);
+}
+
+// ************************************************************************************************
+void diferencia_grupos(const vector<vector<float>> &coeficientes, const cohorte_metilacion &cohorte,
+                       const vector<int> &grupo, const criterio_dmr &criterio, size_t regiones,
+                       float *diferencia, unsigned hilos)
+{
+    diferencia_bloques([&](size_t b, size_t s) { return coeficientes[s].data() + b * BLOQUE_DMR; },
+                       coeficientes.size(), regiones, cohorte, grupo, criterio, diferencia, nullptr, hilos);
+}
+
+// ************************************************************************************************
+void indice_umbral::construye(const float *diferencia, size_t regiones)
+{
+    clear();
+
+    // candidatas: las demás (cero o NaN) no superan ningún umbral no negativo
+    for (size_t m = 0; m < regiones; m++)
+        if (fabs(diferencia[m]) > 0.0f)
+            orden.push_back(uint32_t(m));
+
+    // mayor magnitud primero; a igual magnitud, por posición
+    stable_sort(orden.begin(), orden.end(), [&](uint32_t a, uint32_t b)
+    {
+        return fabs(diferencia[a]) > fabs(diferencia[b]);
+    });
+
+    magnitud.resize(orden.size());
+    tramos.resize(orden.size() + 1);
+    tramos[0] = 0;
+
+    vector<bool> activa(regiones, false);
+    for (size_t k = 0; k < orden.size(); k++)
+    {
+        uint32_t m = orden[k];
+        bool anterior  = (m > 0 && activa[m - 1]);
+        bool siguiente = (m + 1 < regiones && activa[m + 1]);
+
+        activa[m]     = true;
+        magnitud[k]   = fabs(diferencia[m]);
+        tramos[k + 1] = tramos[k] + 1 - uint32_t(anterior) - uint32_t(siguiente);
+    }
+}
+
+// ************************************************************************************************
+size_t indice_umbral::candidatas(float umbral) const
+{
+    // primera magnitud que no supera el umbral (orden descendente)
+    return size_t(upper_bound(magnitud.begin(), magnitud.end(), umbral, greater_equal<float>()) - magnitud.begin());
+}
+
+// ************************************************************************************************
+void indice_umbral::regiones(float umbral, vector<uint32_t> &salida) const
+{
+    salida.assign(orden.begin(), orden.begin() + long(candidatas(umbral)));
+    sort(salida.begin(), salida.end());
+}
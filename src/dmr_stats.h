@@ -0,0 +1,178 @@
+#ifndef DMR_STATS_H
+#define DMR_STATS_H
+
+#include "cohort_store.h"
+
+// regiones que procesa cada hilo de una vez: sus acumuladores y cuentas de sitios quedan en L1/L2
+#define BLOQUE_DMR 1024
+
+/** ***********************************************************************************************
+  *  \brief coeficientes de las muestras dispuestos por bloques de BLOQUE_DMR regiones: cada bloque
+  *         guarda seguidas las BLOQUE_DMR regiones de la muestra 0, después las de la muestra 1,
+  *         etc., de modo que las reducciones por región entre muestras de un bloque recorren
+  *         memoria contigua y alineada a línea de caché (64 bytes) en lugar de una fila por muestra
+  *  \param muestras    número de muestras
+  *  \param regiones    número de regiones por muestra
+  * ***********************************************************************************************
+  */
+struct matriz_bloques
+{
+    size_t muestras = 0;
+    size_t regiones = 0;
+
+    /** ***********************************************************************************************
+      * \fn void construye(const vector<vector<float>> &, size_t, unsigned)
+      *  \brief Copia las 'regiones' primeras columnas de cada fila en la disposición por bloques;
+      *         las regiones que faltan en una fila o completan el último bloque quedan a cero
+      * ***********************************************************************************************
+      */
+    void construye(const vector<vector<float>> &filas, size_t regiones, unsigned hilos);
+
+    // filas por muestra, para comparar con la disposición original
+    vector<vector<float>> filas() const;
+
+    // BLOQUE_DMR coeficientes de la muestra s en el bloque b
+    const float *bloque(size_t b, size_t s) const { return datos.data() + inicio + (b * muestras + s) * BLOQUE_DMR; }
+    float       *bloque(size_t b, size_t s)       { return datos.data() + inicio + (b * muestras + s) * BLOQUE_DMR; }
+
+    float valor(size_t s, size_t m) const { return bloque(m / BLOQUE_DMR, s)[m % BLOQUE_DMR]; }
+
+    size_t bloques() const { return (regiones + BLOQUE_DMR - 1) / BLOQUE_DMR; }
+    size_t bytes() const   { return datos.size() * sizeof(float); }
+    void   clear()         { vector<float>().swap(datos); inicio = 0; muestras = 0; regiones = 0; }
+
+private:
+    vector<float> datos;            // bloques, con holgura para alinear el primero
+    size_t        inicio = 0;       // desplazamiento del primer bloque alineado dentro de datos
+};
+
+/** ***********************************************************************************************
+  *  \brief parámetros de la comparación entre grupos de las regiones de un cromosoma
+  *  \param origen          posición del cromosoma donde empieza la región 0
+  *  \param paso            posiciones por región (2^nivel de detección)
+  *  \param minimo_sitios   posiciones metiladas mínimas de una muestra en la región para contarla
+  *  \param minimo_casos    muestras de casos mínimas con sitios suficientes en la región
+  *  \param minimo_control  muestras de control mínimas con sitios suficientes en la región
+  * ***********************************************************************************************
+  */
+struct criterio_dmr
+{
+    uint32_t origen;
+    uint32_t paso;
+    uint32_t minimo_sitios;
+    uint32_t minimo_casos;
+    uint32_t minimo_control;
+};
+
+/** ***********************************************************************************************
+  *  \brief estadística de cada región calculada en la misma pasada que la diferencia de medias
+  *  \param casos               muestras de casos con sitios suficientes en la región
+  *  \param control             muestras de control con sitios suficientes en la región
+  *  \param varianza_casos      varianza muestral (n - 1) de los coeficientes de los casos
+  *  \param varianza_control    varianza muestral (n - 1) de los coeficientes de los controles
+  *  \param t                   t de Welch de la diferencia: diferencia / √(vc/nc + vk/nk); 0 si la
+  *                             región no se compara o algún grupo tiene menos de dos muestras
+  * ***********************************************************************************************
+  */
+struct estadistica_dmr
+{
+    vector<uint32_t> casos;
+    vector<uint32_t> control;
+    vector<float>    varianza_casos;
+    vector<float>    varianza_control;
+    vector<float>    t;
+
+    void resize(size_t regiones)
+    {
+        casos.resize(regiones);
+        control.resize(regiones);
+        varianza_casos.resize(regiones);
+        varianza_control.resize(regiones);
+        t.resize(regiones);
+    }
+
+    void clear()
+    {
+        vector<uint32_t>().swap(casos);
+        vector<uint32_t>().swap(control);
+        vector<float>().swap(varianza_casos);
+        vector<float>().swap(varianza_control);
+        vector<float>().swap(t);
+    }
+};
+
+/** ***********************************************************************************************
+  * \fn void diferencia_grupos(const matriz_bloques &, const cohorte_metilacion &,
+  *                            const vector<int> &, const criterio_dmr &, float *, estadistica_dmr *, unsigned)
+  *  \brief Diferencia de medias de los coeficientes entre casos y controles en cada región:
+  *         media(casos) - media(controles) de las muestras con al menos minimo_sitios posiciones
+  *         estrictamente dentro de la región (origen + m·paso, origen + (m + 1)·paso), sin contar
+  *         la última posición de cada muestra; 0 si algún grupo no llega a su mínimo de muestras.
+  *         Los bloques de regiones se reparten entre los hilos; en cada bloque se cuentan los
+  *         sitios de cada muestra con la presencia de la cohorte y se acumulan con los núcleos
+  *         vectoriales, recorriendo las muestras en orden para que las sumas sean las mismas que
+  *         las de un recorrido serie. Las mismas acumulaciones dan, sin otra pasada por los
+  *         coeficientes, el número de muestras, la varianza de cada grupo y la t de Welch
+  *  \param &coeficientes   coeficientes de cada muestra por bloques de regiones
+  *  \param &cohorte        diccionario de posiciones y presencia de cada muestra
+  *  \param &grupo          grupo de cada muestra: 0 control, cualquier otro valor casos
+  *  \param &criterio       límites de las regiones y mínimos para comparar
+  *  \param *diferencia     diferencia de cada región (coeficientes.regiones)
+  *  \param *estadistica    estadística de cada región (nullptr si no se necesita)
+  *  \param hilos           número de hilos a utilizar
+  * ***********************************************************************************************
+  */
+void diferencia_grupos(const matriz_bloques &coeficientes, const cohorte_metilacion &cohorte,
+                       const vector<int> &grupo, const criterio_dmr &criterio, float *diferencia,
+                       estadistica_dmr *estadistica, unsigned hilos);
+
+/** ***********************************************************************************************
+  * \fn void diferencia_grupos(const vector<vector<float>> &, const cohorte_metilacion &,
+  *                            const vector<int> &, const criterio_dmr &, size_t, float *, unsigned)
+  *  \brief Misma diferencia sobre los coeficientes en filas por muestra (al menos 'regiones' por
+  *         fila), que se leen con un salto de fila por muestra en cada bloque
+  * ***********************************************************************************************
+  */
+void diferencia_grupos(const vector<vector<float>> &coeficientes, const cohorte_metilacion &cohorte,
+                       const vector<int> &grupo, const criterio_dmr &criterio, size_t regiones,
+                       float *diferencia, unsigned hilos);
+
+/** ***********************************************************************************************
+  *  \brief índice de las regiones por |diferencia| para responder a cualquier umbral sin recorrer
+  *         todas las regiones: las candidatas (|diferencia| > 0) ordenadas de mayor a menor
+  *         magnitud y, para cada prefijo de ese orden, el número de DMRs (tramos de regiones
+  *         contiguas) que forman. Una región supera el umbral t >= 0 si diferencia > t o
+  *         diferencia < -t, es decir si |diferencia| > t, por lo que las que lo superan son
+  *         siempre un prefijo del orden
+  *  \param orden       regiones candidatas por |diferencia| descendente
+  *  \param magnitud    |diferencia| de cada región de 'orden'
+  *  \param tramos      tramos[k]: DMRs que forman las k primeras regiones de 'orden'
+  * ***********************************************************************************************
+  */
+struct indice_umbral
+{
+    vector<uint32_t> orden;
+    vector<float>    magnitud;
+    vector<uint32_t> tramos;
+
+    /** ***********************************************************************************************
+      * \fn void construye(const float *, size_t)
+      *  \brief Ordena las regiones candidatas y cuenta los tramos de cada prefijo: al activar una
+      *         región se crea un tramo, o se une a uno o dos vecinos ya activos, O(n log n)
+      * ***********************************************************************************************
+      */
+    void construye(const float *diferencia, size_t regiones);
+
+    // número de regiones con |diferencia| > umbral, por búsqueda binaria
+    size_t candidatas(float umbral) const;
+
+    // número de DMRs con el umbral dado, sin recorrer las regiones
+    size_t dmrs(float umbral) const { return tramos.empty() ? 0 : tramos[candidatas(umbral)]; }
+
+    // regiones que superan el umbral, en orden de posición
+    void regiones(float umbral, vector<uint32_t> &salida) const;
+
+    void clear() { vector<uint32_t>().swap(orden); vector<float>().swap(magnitud); vector<uint32_t>().swap(tramos); }
+};
+
+#endif // DMR_STATS_H
@@ -1,20 +1,42 @@
 #include "files_worker.h"
 #include <QDebug>
+#include <QByteArray>
 #include <sstream>
 #include <iostream>
+#include <cstring>
+#include <cstdlib>
 
+// tamaño de los tramos en que se analiza cada fichero para informar del progreso de lectura
+#define TRAMO_PROGRESO (64 * 1024 * 1024)
+
+// ************************************************************************************************
+QString ruta_mapa(const QString &base)
+{
+    // extensiones admitidas por orden de preferencia: texto, gzip y bgzip
+    const QStringList extensiones = {".csv", ".csv.gz", ".csv.bgz"};
+
+    foreach (auto extension, extensiones)
+        if (QFile::exists(base + extension))
+            return base + extension;
+
+    return base + ".csv";
+}
+
+// ************************************************************************************************
 Files_worker::Files_worker(QObject *parent)
     : QObject(parent)
 {
     aborted = false;
     working = false;
+    filtra  = false;
 }
 
 // ************************************************************************************************
 void Files_worker::solicitud_lectura(QStringList cases_files,
                                      QStringList control_files,
                                      QStringList parametros,
-                                     vector<vector<vector<double>>> &mcx,
+                                     vector<muestra_metilacion> &mcx,
+                                     QQueue<int> &colax,
                                      QMutex &mutexx)
 {
     lista_casos     = cases_files;
@@ -23,9 +45,27 @@ void Files_worker::solicitud_lectura(QStringList cases_files,
     //  0   forward bool
     //  1   reverse bool
     //  2   cromosoma
-    //  3   número de fichero asignado (hilo)
+    //  3   número de lector asignado (hilo)
+    //  4   número de hilos para analizar cada fichero
+    //  5   filtrado por cobertura durante la lectura 0/1
+    //  6   cobertura mínima de las posiciones
+    //  7   cobertura sobre mC '0' o hmC '1'
+    //  8   primera posición de la región a leer (0 desde el principio)
+    //  9   última posición de la región a leer (0 hasta el final)
+    // 10   compresión en memoria de la muestra leída 0/1
     argumentos      = parametros;
+
+    filtra = false;
+    if (argumentos.size() > 9)
+    {
+        filtro.cobertura_minima = argumentos[5].toInt() ? argumentos[6].toUInt() : 0;
+        filtro.hmC              = argumentos[7].toInt();
+        filtro.inicio           = argumentos[8].toUInt();
+        filtro.final            = argumentos[9].toUInt();
+        filtra                  = argumentos[5].toInt() || filtro.inicio > 0 || filtro.final > 0;
+    }
     mc              = &mcx;
+    cola            = &colax;
     mutex           = &mutexx;
 
     aborted         = false;
@@ -34,6 +74,26 @@ void Files_worker::solicitud_lectura(QStringList cases_files,
     emit lectura_solicitada();
 }
 
+// ************************************************************************************************
+void Files_worker::solicitud_region(QStringList cases_files,
+                                    QStringList control_files,
+                                    QStringList parametros,
+                                    uint inicio,
+                                    uint final,
+                                    vector<muestra_metilacion> &mcx,
+                                    QQueue<int> &colax,
+                                    QMutex &mutexx)
+{
+    // completa los parámetros sin filtro de cobertura si no se han informado
+    while (parametros.size() < 10)
+        parametros << "0";
+
+    parametros[8] = QString::number(inicio);
+    parametros[9] = QString::number(final);
+
+    solicitud_lectura(cases_files, control_files, parametros, mcx, colax, mutexx);
+}
+
 // ************************************************************************************************
 void Files_worker::abort()
 {
@@ -44,6 +104,34 @@ void Files_worker::abort()
 // ************************************************************************************************
 void Files_worker::lectura()
 {
+    // toma ficheros de la cola compartida hasta vaciarla
+    // el número de lectores está limitado, de modo que cada lector lee varios ficheros
+    while (!aborted)
+    {
+        mutex->lock();
+        if (cola->isEmpty())
+        {
+            mutex->unlock();
+            break;
+        }
+        numero_fichero = cola->dequeue();
+        mutex->unlock();
+
+        lee_fichero();
+    }
+
+    // trabajo de lectura de ficheros finalizado
+    aborted = true;
+    working = false;
+
+    emit finished();
+}
+
+// ************************************************************************************************
+void Files_worker::lee_fichero()
+{
+    INIT_TIMER
+
     int inicio = 100000000;
     int final  = 0;
 
@@ -57,142 +145,354 @@ void Files_worker::lectura()
         que_leo = 1;
     }
 
-    vector<vector<double>> aux3;        // vector auxiliar para montar fichero de proporción de metilación para forward
-
     // inicializa la posición inferior y superior
     QString fichero       = "";
-    QString linea         = "";
-    string numero         = "";         // dato de cada muestra en la posición de línea leida
-    vector<int> aux1;                   // vector auxiliar para lectura de fichero
-    vector<double> aux2;                // vector auxiliar para proporcion de metilación por fichero
-    double cobertura_mC   = 0.0;
-    double cobertura_hmC  = 0.0;
-    double metilado       = 0.0;
-    double h_metilado     = 0.0;
-    double proporcion_mC  = 0.0;
-    double proporcion_hmC = 0.0;
 
     // abre el fichero correspondiente para leer y almacenar
-    if (argumentos[3].toInt() - lista_casos.size() < 0)
-        fichero = lista_casos[argumentos[3].toInt()] +
-                  "/methylation_map_" +
-                  leer[que_leo] +
-                  argumentos.at(2) +
-                  ".csv";
+    if (numero_fichero - lista_casos.size() < 0)
+        fichero = ruta_mapa(lista_casos[numero_fichero] +
+                            "/methylation_map_" +
+                            leer[que_leo] +
+                            argumentos.at(2));
     else
-        fichero = lista_controles[argumentos[3].toInt() - lista_casos.size()] +
-                  "/methylation_map_" +
-                  leer[que_leo] +
-                  argumentos.at(2) +
-                  ".csv";
+        fichero = ruta_mapa(lista_controles[numero_fichero - lista_casos.size()] +
+                            "/methylation_map_" +
+                            leer[que_leo] +
+                            argumentos.at(2));
 
     data.setFileName(fichero);
 
+    columnas_mapa sitios;                   // columnas con los datos leídos del fichero
+
+#ifdef LECTURA_MMAP
+    bool          leido = false;
+
+    // hilos para analizar el fichero en bloques, repartidos por el hilo principal
+    unsigned hilos_lectura = (argumentos.size() > 4 && argumentos[4].toInt() > 1) ? unsigned(argumentos[4].toInt()) : 1;
+
+    // medida de los dos lectores sobre el mismo fichero, antes de cargarlo
+    const char *compara = getenv(VARIABLE_COMPARA_LECTURA);
+    if (compara != nullptr && strcmp(compara, "1") == 0)
+        compara_lectura(fichero, hilos_lectura);
+
+#ifdef INDICE_REGION
+    // con una ventana de posiciones solo se leen las líneas de la región, localizadas con el índice
+    if (filtra && (filtro.inicio > 0 || filtro.final > 0))
+        leido = lee_region(fichero, sitios, hilos_lectura);
+#endif
+
+#ifdef CACHE_BINARIA
+    // si existe una caché binaria actualizada del fichero se carga directamente de ella
+    if (!leido && lee_cache_mapa(fichero, sitios))
+    {
+        STOP_TIMER_MBS("lectura caché de " + fichero, qint64(sitios.size() * 5 * sizeof(uint32_t)))
+
+        // la caché guarda todas las posiciones, el filtro se aplica tras cargarla
+        if (filtra)
+            filtra_mapa(sitios, filtro);
+
+        leido = true;
+    }
+#endif
+
+    if (!leido)
+        lee_mapa(fichero, sitios, hilos_lectura);
+#else
+    lee_lineas(fichero, sitios);
+#endif
+
+    // cierra el fichero de datos
+    data.close();
+
+    // actualiza la posición mínima y máxima
+    if (sitios.size() > 0)
+    {
+        inicio = int(sitios.posicion.front());
+        final  = int(sitios.posicion.back());
+    }
+
+    // entrega los datos a la matriz principal sin copiarlos, en el hueco reservado para la muestra
+    // (casos y después controles); cada lector escribe en huecos distintos, sin bloqueo
+    (*mc)[size_t(numero_fichero)] = monta_muestra(sitios, que_leo);
+
+    // envía señal de lectura de fichero para su procesado en otro hilo
+    emit progreso_lectura(numero_fichero, 100);
+    emit fichero_leido(numero_fichero, argumentos.at(2).toInt(), inicio, final);
+}
+
+// ************************************************************************************************
+void Files_worker::lee_lineas(const QString &fichero, columnas_mapa &sitios)
+{
+    INIT_TIMER
+
+    QString linea         = "";
+    string numero         = "";         // dato de cada muestra en la posición de línea leida
+    vector<int> aux1;                   // vector auxiliar para lectura de fichero
+
     // comprueba que el fichero se ha abierto correctamente
-    if (!data.open(QIODevice::ReadOnly | QIODevice::Text))
+    QFile texto(fichero);
+    if (!texto.open(QIODevice::ReadOnly | QIODevice::Text))
     {
         qDebug() << "ERROR opening file: " << fichero;
     }
     else
     {
+        qint64 bytes = texto.size();
+
         // lee y guarda todos los datos
-        while (!data.atEnd())
+        while (!texto.atEnd())
         {
             if (aborted)
                 break;
 
-            linea = data.readLine();
+            linea = texto.readLine();
             stringstream posicion (linea.toStdString());
 
             while (getline (posicion, numero, ' '))
                 if (isdigit(numero[0]))
                     aux1.push_back(stoi(numero));
 
-            // procesamiento de los datos de la línea
-            // como cobertura se suma en número de C y mC o hmC
-            // se descarta el número de nC
-            cobertura_mC  = aux1[1] + aux1[3];
-            metilado      = aux1[3];
-            cobertura_hmC = aux1[4] + aux1[6];
-            h_metilado    = aux1[6];
-
-            if (cobertura_mC > 0)
-                proporcion_mC = metilado / cobertura_mC;
-            else
+            // si la primera posición es cero no se contempla para preservar la integridad de
+            // la identificación de DMRs tal y como está definido
+            if (aux1.size() > 6 && aux1[0] > 0 &&
+                (!filtra || filtro.admite(uint32_t(aux1[0]), uint32_t(aux1[1]), uint32_t(aux1[4]), uint32_t(aux1[3]), uint32_t(aux1[6]))))
             {
-                proporcion_mC = 0.0;
-                metilado      = 0.0;
-                cobertura_mC  = 0.0;
+                sitios.posicion.push_back(uint32_t(aux1[0]));
+                sitios.C.push_back(uint32_t(aux1[1]));
+                sitios.nC.push_back(uint32_t(aux1[4]));
+                sitios.mC.push_back(uint32_t(aux1[3]));
+                sitios.hmC.push_back(uint32_t(aux1[6]));
             }
 
-            if (cobertura_hmC > 0)
-                proporcion_hmC = h_metilado / cobertura_hmC;
-            else
-            {
-                proporcion_hmC = 0.0;
-                h_metilado     = 0.0;
-                cobertura_hmC  = 0.0;
-            }
+            aux1.clear();
+        }
 
-            // guardado de los datos de un cromosoma de una muestra de un sentido
-            // 0    posición en el cromosoma
-            // 1    proporción de mC frente a la cobertura
-            // 2    cobertura de mC (C + mC)reads
-            // 3    número de reads identificando una C metilada
-            // 4    número de reads identificando una C hidroximetilada
-            // 5    número de reads identificando una mC
-            // 6    número de reads identificando una hmC
-            // 7    proporción de hmC frente a cobertura
-            // 8    cobertura de hmC (Ch + hmC)reads
-            // 9    chromosoma
-            // 10   muestra (posición en la lista de caso o control)
-            // 11   caso/control (0/1)
-            // 12   forward/reverse (0/1)
-            aux2.push_back(aux1[0]);
-            aux2.push_back(proporcion_mC);
-            aux2.push_back(cobertura_mC);
-            aux2.push_back(aux1[1]);
-            aux2.push_back(aux1[4]);
-            aux2.push_back(aux1[3]);
-            aux2.push_back(aux1[6]);
-            aux2.push_back(proporcion_hmC);
-            aux2.push_back(cobertura_hmC);
-            aux2.push_back(argumentos[2].toInt());
-            aux2.push_back((argumentos[3].toInt() - lista_casos.size() < 0) ? argumentos[3].toInt() : argumentos[3].toInt() - lista_casos.size());
-            aux2.push_back((argumentos[3].toInt() < lista_casos.size()) ? 0 : 1 );
-            aux2.push_back(que_leo);
+        STOP_TIMER_MBS("lectura por líneas de " + fichero, bytes)
+    }
+}
 
-            // si la primera posición es cero no se contempla para preservar la integridad de
-            // la identificación de DMRs tal y como está definido
-            if (aux1[0] > 0)
-                aux3.push_back(aux2);
+// ************************************************************************************************
+void Files_worker::compara_lectura(const QString &fichero, unsigned hilos)
+{
+    QFile original(fichero);
+    if (!original.open(QIODevice::ReadOnly))
+        return;
 
-            aux1.clear();
-            aux2.clear();
-        }
+    qint64      bytes = original.size();
+    uchar      *mapa  = (bytes > 0) ? original.map(0, bytes) : nullptr;
+    const char *texto = reinterpret_cast<const char *>(mapa);
+    if (mapa == nullptr || es_gzip(texto, texto + bytes))
+    {
+        // el lector por líneas solo admite texto, y la comparación necesita la proyección
+        qDebug() << "comparación de lectura no disponible para: " << fichero;
+        if (mapa != nullptr)
+            original.unmap(mapa);
+        return;
+    }
+
+    columnas_mapa lineas;
+    columnas_mapa proyeccion;
+
+    auto inicio = std::chrono::high_resolution_clock::now();
+    lee_lineas(fichero, lineas);
+    auto medio  = std::chrono::high_resolution_clock::now();
+    analiza_por_tramos(texto, texto + bytes, proyeccion, hilos);
+    auto fin    = std::chrono::high_resolution_clock::now();
+
+    original.unmap(mapa);
+
+    double megas               = double(bytes) / (1024.0 * 1024.0);
+    double segundos_lineas     = std::chrono::duration<double>(medio - inicio).count() + 1e-9;
+    double segundos_proyeccion = std::chrono::duration<double>(fin - medio).count() + 1e-9;
+    bool   iguales             = lineas.posicion == proyeccion.posicion &&
+                                 lineas.C        == proyeccion.C        &&
+                                 lineas.nC       == proyeccion.nC       &&
+                                 lineas.mC       == proyeccion.mC       &&
+                                 lineas.hmC      == proyeccion.hmC;
+
+    qDebug() << "comparación de lectura de" << fichero << ":" << megas << "MB -"
+             << "por líneas" << megas / segundos_lineas << "MB/s -"
+             << "mmap con" << hilos << "hilos" << megas / segundos_proyeccion << "MB/s -"
+             << "aceleración" << segundos_lineas / segundos_proyeccion
+             << (iguales ? "- mismos datos" : "- LOS DATOS LEÍDOS NO COINCIDEN");
+}
+
+// ************************************************************************************************
+void Files_worker::lee_mapa(const QString &fichero, columnas_mapa &sitios, unsigned hilos)
+{
+    INIT_TIMER
 
-        // actualiza la posición mínima y máxima
-        if (inicio >= int(aux3.front().front()))
-            inicio = int(aux3.front().front());
-        if (final < int(aux3.back().front()))
-            final = int(aux3.back().front());
+    // comprueba que el fichero se ha abierto correctamente
+    // sin modo texto: el fichero se proyecta en memoria tal cual está en disco
+    if (!data.open(QIODevice::ReadOnly))
+    {
+        qDebug() << "ERROR opening file: " << fichero;
+        return;
     }
 
-    // cierra el fichero de datos
-    data.close();
+    qint64 bytes = data.size();
 
-    // carga los datos en la matriz principal
-    mutex->lock();
-    mc->push_back(aux3);
-    mutex->unlock();
+    // proyecta el fichero en memoria y analiza las líneas directamente sobre la proyección,
+    // sin copias ni reservas de memoria por línea
+    QByteArray  contenido;
+    uchar      *mapa  = (bytes > 0) ? data.map(0, bytes) : nullptr;
+    const char *texto = reinterpret_cast<const char *>(mapa);
+    if (mapa == nullptr)
+    {
+        // sistema de ficheros sin soporte de proyección: se lee el fichero completo de una vez
+        contenido = data.readAll();
+        texto     = contenido.constData();
+        bytes     = contenido.size();
+    }
 
-    // envía señal de lectura de fichero para su procesado en otro hilo
-    emit fichero_leido(argumentos[3].toInt(), argumentos.at(2).toInt(), inicio, final);
+    analiza_por_tramos(texto, texto + bytes, sitios, hilos);
+
+    STOP_TIMER_MBS("lectura mmap de " + fichero, bytes)
+
+#ifdef INDICE_REGION
+    // índice de posiciones para las siguientes lecturas por región (solo ficheros de texto ordenados)
+    vector<entrada_indice> indice;
+    if (!aborted && !es_gzip(texto, texto + bytes) && !lee_indice_mapa(fichero, indice))
+    {
+        if (construye_indice_mapa(texto, texto + bytes, indice))
+            escribe_indice_mapa(fichero, indice);
+        else
+            qDebug() << "posiciones desordenadas, no se indexa el fichero: " << fichero;
+    }
+#endif
+
+    if (mapa != nullptr)
+        data.unmap(mapa);
+
+#ifdef CACHE_BINARIA
+    // guarda la caché para las siguientes cargas del cromosoma (una lectura abortada
+    // o filtrada está incompleta y no se guarda)
+    if (!aborted && !filtra)
+        escribe_cache_mapa(fichero, sitios);
+#endif
+}
+
+// ************************************************************************************************
+bool Files_worker::lee_region(const QString &fichero, columnas_mapa &sitios, unsigned hilos)
+{
+    INIT_TIMER
+
+    // sin índice válido se lee el fichero completo, que deja creado el índice para la siguiente vez
+    vector<entrada_indice> indice;
+    if (!lee_indice_mapa(fichero, indice))
+        return false;
+
+    if (!data.open(QIODevice::ReadOnly))
+    {
+        qDebug() << "ERROR opening file: " << fichero;
+        return false;
+    }
+
+    // tramo del fichero con las líneas de la región
+    uint64_t desde = 0;
+    uint64_t hasta = 0;
+    tramo_region(indice, uint64_t(data.size()), filtro.inicio, filtro.final, desde, hasta);
+    qint64 bytes = qint64(hasta - desde);
+
+    if (bytes > 0)
+    {
+        uchar *mapa = data.map(qint64(desde), bytes);
+        if (mapa != nullptr)
+        {
+            const char *texto = reinterpret_cast<const char *>(mapa);
+            analiza_por_tramos(texto, texto + bytes, sitios, hilos);
+            data.unmap(mapa);
+        }
+        else
+        {
+            data.seek(qint64(desde));
+            QByteArray contenido = data.read(bytes);
+            analiza_por_tramos(contenido.constData(), contenido.constData() + contenido.size(), sitios, hilos);
+        }
+    }
 
-    // trabajo de lectura de ficheros finalizado
-    aborted = true;
-    working = false;
     data.close();
 
-    emit finished();
+    STOP_TIMER_MBS("lectura de región de " + fichero, bytes)
+
+    return true;
+}
+
+// ************************************************************************************************
+muestra_metilacion Files_worker::monta_muestra(columnas_mapa &sitios, int que_leo)
+{
+    muestra_metilacion muestra;
+
+    // datos comunes a todas las posiciones de la muestra
+    muestra.cromosoma = argumentos[2].toInt();
+    muestra.muestra   = (numero_fichero - lista_casos.size() < 0) ? numero_fichero : numero_fichero - lista_casos.size();
+    muestra.grupo     = (numero_fichero < lista_casos.size()) ? 0 : 1;
+    muestra.sentido   = que_leo;
+
+    // las columnas pasan a la muestra sin copiarse, liberando la reserva sobrante de la lectura
+    muestra.sitios = move(sitios);
+
+    // compresión opcional de la muestra en memoria
+    if (argumentos.size() > 10 && argumentos[10].toInt())
+    {
+        size_t bytes = muestra.bytes();
+        if (muestra.comprime())
+            qDebug() << "muestra comprimida: " << bytes << " -> " << muestra.bytes() << " bytes";
+        else
+            qDebug() << "posiciones desordenadas, la muestra no se comprime";
+    }
+
+    if (!muestra.comprimida())
+        muestra.sitios.shrink_to_fit();
+
+    return muestra;
+}
+
+// ************************************************************************************************
+void Files_worker::analiza_por_tramos(const char *inicio, const char *final, columnas_mapa &sitios, unsigned hilos)
+{
+    const char *p     = inicio;
+    qint64      bytes = final - inicio;
+    int         hecho = 0;
+
+    // ficheros comprimidos con gzip o bgzip: se descomprimen en memoria conforme se analizan
+    if (es_gzip(inicio, final))
+    {
+        bool correcto = parsea_mapa_gzip(inicio, final, sitios, hilos, [&](size_t leidos)
+        {
+            int porcentaje = int(100 * qint64(leidos) / (bytes > 0 ? bytes : 1));
+            if (porcentaje > hecho && porcentaje < 100)
+            {
+                hecho = porcentaje;
+                emit progreso_lectura(numero_fichero, porcentaje);
+            }
+            return !aborted;
+        }, filtra ? &filtro : nullptr);
+
+        if (!correcto && !aborted)
+            qDebug() << "ERROR decompressing file, data read up to the damaged block: " << data.fileName();
+        return;
+    }
+
+    while (p < final && !aborted)
+    {
+        // corta el tramo en el siguiente salto de línea
+        const char *corte = (final - p > TRAMO_PROGRESO) ? p + TRAMO_PROGRESO : final;
+        if (corte < final)
+        {
+            const char *salto = static_cast<const char *>(memchr(corte, '\n', size_t(final - corte)));
+            corte = (salto != nullptr) ? salto + 1 : final;
+        }
+
+        parsea_mapa_paralelo(p, corte, sitios, hilos, filtra ? &filtro : nullptr);
+        p = corte;
+
+        // informa del avance de la lectura del fichero
+        int porcentaje = int(100 * (p - inicio) / (bytes > 0 ? bytes : 1));
+        if (porcentaje > hecho && porcentaje < 100)
+        {
+            hecho = porcentaje;
+            emit progreso_lectura(numero_fichero, porcentaje);
+        }
+    }
 }
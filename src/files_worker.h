@@ -5,9 +5,42 @@
 #include <QFile>
 #include <QVector>
 #include <QMutex>
+#include <QQueue>
+#include "data_pack.h"
+#include "map_parser.h"
+#include "map_cache.h"
+#include "map_gzip.h"
+#include "map_index.h"
+#include "sample_store.h"
+
+// lectura de los methylation_map proyectando el fichero en memoria (mmap)
+// sin definir, se emplea la lectura original línea a línea con QFile::readLine
+// (los ficheros comprimidos .csv.gz / .csv.bgz solo se admiten con LECTURA_MMAP)
+#define LECTURA_MMAP
+
+// guarda junto a cada methylation_map una caché binaria por columnas (.dhc) en la primera
+// lectura y la utiliza en las siguientes mientras el fichero original no cambie
+// (solo con LECTURA_MMAP)
+#define CACHE_BINARIA
+
+// guarda junto a cada methylation_map un índice de posiciones (.idx) en la primera lectura
+// completa y lo utiliza para leer solo las líneas de la región pedida (solo con LECTURA_MMAP)
+#define INDICE_REGION
+
+// con LECTURA_MMAP, si la variable de entorno HPG_DHUNTER_COMPARA_LECTURA vale "1" cada fichero de
+// texto se analiza además con los dos lectores y se informa de los MB/s de cada uno
+#define VARIABLE_COMPARA_LECTURA "HPG_DHUNTER_COMPARA_LECTURA"
 
 using namespace std;
 
+/**
+ * \fn QString ruta_mapa(const QString &)
+ * @brief Devuelve la ruta del methylation_map existente para la ruta base dada, probando las
+ *        extensiones .csv, .csv.gz y .csv.bgz; si no existe ninguno devuelve la ruta .csv
+ * @param &base     ruta del fichero sin extensión (directorio/methylation_map_<sentido>_<cromosoma>)
+ */
+QString ruta_mapa(const QString &base);
+
 class Files_worker : public QObject
 {
     Q_OBJECT
@@ -16,20 +49,44 @@ public:
     Files_worker(QObject *parent = nullptr);
 
     /**
-     * \fn void solicitud_lectura(QStringList, QStringList, QStringList, vector<vector<vector<float>>> &, QMutex &)
+     * \fn void solicitud_lectura(QStringList, QStringList, QStringList, vector<muestra_metilacion> &, QQueue<int> &, QMutex &)
      * @brief Solicita al worker que comience
      * @param cases_files   ruta del ejecutable
      * @param control_files opciones para la ejecución
      * @param parameters    ruta para guardas los ficheros mapeados
-     * @param &mcx          matriz de datos por posición y muestra
+     * @param &mcx          matriz de datos por posición y muestra, con un hueco por muestra
+     * @param &colax        cola compartida con los números de fichero pendientes de leer
      * @param &mutexx       control de acceso a memoria compartida
      */
     void solicitud_lectura(QStringList cases_files,
                            QStringList control_files,
                            QStringList parameters,
-                           vector<vector<vector<double>>> &mcx,
+                           vector<muestra_metilacion> &mcx,
+                           QQueue<int> &colax,
                            QMutex &mutexx);
 
+    /**
+     * \fn void solicitud_region(QStringList, QStringList, QStringList, uint, uint, vector<muestra_metilacion> &, QQueue<int> &, QMutex &)
+     * @brief Solicita al worker que lea solo las posiciones [inicio, final] de cada fichero,
+     *        saltando con el índice de posiciones directamente a las líneas de la región
+     * @param cases_files   directorios de las muestras caso
+     * @param control_files directorios de las muestras control
+     * @param parameters    parámetros de lectura (ver solicitud_lectura)
+     * @param inicio        primera posición de la región
+     * @param final         última posición de la región (0 hasta el final del cromosoma)
+     * @param &mcx          matriz de datos por posición y muestra, con un hueco por muestra
+     * @param &colax        cola compartida con los números de fichero pendientes de leer
+     * @param &mutexx       control de acceso a memoria compartida
+     */
+    void solicitud_region(QStringList cases_files,
+                          QStringList control_files,
+                          QStringList parameters,
+                          uint inicio,
+                          uint final,
+                          vector<muestra_metilacion> &mcx,
+                          QQueue<int> &colax,
+                          QMutex &mutexx);
+
     /**
      * @brief Solicita al worker que se detenga
      */
@@ -53,6 +110,14 @@ signals:
      */
     void fichero_leido(int sample, int chrom, int inicio, int final);//, QVector<QString> &fichero);
 
+    /**
+     * @fn void progreso_lectura(int, int)
+     * @brief Esta señal se emite conforme avanza la lectura de un fichero
+     * @param  sample       orden que ocupa la muestra que se está leyendo en la lista
+     * @param  porcentaje   porcentaje del fichero leído
+     */
+    void progreso_lectura(int sample, int porcentaje);
+
     /**
      * @fn void finished()
      * @brief Esta señal se emite cuando el proceso termina o se aborta
@@ -62,11 +127,72 @@ signals:
 public slots:
     /**
      * @fn void lectura()
-     * @brief ejecuta el trabajo de mapeado sobre todos los elementos de la lista
+     * @brief lee ficheros de la cola compartida hasta que no quedan ficheros pendientes
      */
     void lectura();
 
 private:
+    /**
+     * @fn void lee_fichero()
+     * @brief lee el fichero 'numero_fichero' y entrega sus datos a la matriz principal
+     */
+    void lee_fichero();
+
+    /**
+     * @fn void lee_mapa(const QString &, columnas_mapa &, unsigned)
+     * @brief lee el fichero completo proyectándolo en memoria y guarda su caché e índice
+     * @param &fichero  ruta del fichero
+     * @param &sitios   columnas donde se añaden las posiciones leídas
+     * @param hilos     número de hilos para analizar el fichero
+     */
+    void lee_mapa(const QString &fichero, columnas_mapa &sitios, unsigned hilos);
+
+    /**
+     * @fn bool lee_region(const QString &, columnas_mapa &, unsigned)
+     * @brief lee solo el tramo del fichero con las posiciones de la ventana del filtro
+     * @param &fichero  ruta del fichero
+     * @param &sitios   columnas donde se añaden las posiciones leídas
+     * @param hilos     número de hilos para analizar el tramo
+     * @return          false si el fichero no tiene un índice válido
+     */
+    bool lee_region(const QString &fichero, columnas_mapa &sitios, unsigned hilos);
+
+    /**
+     * @fn void lee_lineas(const QString &, columnas_mapa &)
+     * @brief lee el fichero de texto completo línea a línea con QFile::readLine (lector original)
+     * @param &fichero  ruta del fichero
+     * @param &sitios   columnas donde se añaden las posiciones leídas
+     */
+    void lee_lineas(const QString &fichero, columnas_mapa &sitios);
+
+    /**
+     * @fn void compara_lectura(const QString &, unsigned)
+     * @brief analiza el mismo fichero de texto con el lector por líneas y con la proyección en
+     *        memoria, sin guardar caché ni índice, e informa del rendimiento en MB/s de cada uno
+     *        y de si han leído los mismos datos
+     * @param &fichero  ruta del fichero
+     * @param hilos     número de hilos para el análisis sobre la proyección
+     */
+    void compara_lectura(const QString &fichero, unsigned hilos);
+
+    /**
+     * @fn void analiza_por_tramos(const char *, const char *, columnas_mapa &, unsigned)
+     * @brief analiza el fichero en tramos consecutivos informando del progreso tras cada tramo
+     * @param *inicio   primer carácter del fichero
+     * @param *final    posición siguiente al último carácter del fichero
+     * @param &sitios   columnas donde se añaden las posiciones leídas
+     * @param hilos     número de hilos para analizar cada tramo
+     */
+    void analiza_por_tramos(const char *inicio, const char *final, columnas_mapa &sitios, unsigned hilos);
+
+    /**
+     * @fn muestra_metilacion monta_muestra(columnas_mapa &, int)
+     * @brief Monta la muestra con las columnas leídas y los datos comunes de la muestra
+     * @param &sitios   columnas con las posiciones leídas del fichero (quedan vacías)
+     * @param que_leo   sentido leído: forward '0', reverse '1', mix '2'
+     */
+    muestra_metilacion monta_muestra(columnas_mapa &sitios, int que_leo);
+
     /**
      * @brief variables internas para control de operaciones y almacenamiento de datos en local
      * @param aborted           señal de control de hilo activo
@@ -75,6 +201,9 @@ private:
      * @param lista_controles   listado de muestras etiquetadas como control
      * @param argumentos        lista de argumentos desde hilo primcipal para carga de ficheros
      * @param data              acceso a fichero en disco para lectura
+     * @param numero_fichero    número del fichero que se está leyendo (casos y después controles)
+     * @param filtra            descarta durante la lectura las posiciones que no cumplen el filtro
+     * @param filtro            cobertura mínima, canal y región de posiciones admitidas
      */
     bool aborted;
     bool working;
@@ -82,11 +211,19 @@ private:
     QStringList lista_controles;
     QStringList argumentos;
     QFile data;
+    int numero_fichero;
+    bool filtra;
+    filtro_mapa filtro;
+
+    /**
+     * @brief muestras donde se almacenan los datos leídos por cromosoma
+     */
+    vector<muestra_metilacion> *mc;
 
     /**
-     * @brief matriz donde se almacenan los datos leídos por cromosoma
+     * @brief cola de ficheros pendientes de leer, compartida por todos los lectores
      */
-    vector<vector<vector<double>>> *mc;
+    QQueue<int> *cola;
 
     /**
      * @brief variable de control de acceso a memoria compartida para todos los hilos
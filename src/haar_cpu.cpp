@@ -0,0 +1,318 @@
+#include "haar_cpu.h"
+#include "paralelo.h"
+#include "haar_simd.h"
+#include <algorithm>
+#include <cmath>
+
+// ************************************************************************************************
+void calculo_haar_L(datos_cuda &cuda_data)
+{
+    // cálculo de número de coeficientes por nivel y del ajuste de paso entre escala y coeficiente
+    cuda_data.h_haar_L.push_front(cuda_data.sample_num);	// última posición guarda el total de posiciones por muestra
+
+    // para cada nivel se divide por dos la cantidad de posiciones del nivel anterior -------------
+    // redondeando al alza y actualizando el ajuste cuando sea impar
+    for (int fila = cuda_data.levels; fila > 0; fila--)
+    {
+        if (ceil(cuda_data.h_haar_L.front() * 0.5 >= 2))
+        {
+            cuda_data.h_haar_L.push_front(ceil(cuda_data.h_haar_L.front() * 0.5));
+            if (fila > 0 && size_t(cuda_data.h_haar_L[1]) != cuda_data.sample_num)
+                cuda_data.data_adjust += size_t(2 * cuda_data.h_haar_L.front() - cuda_data.h_haar_L[1]);
+        }
+        else
+            break;
+    }
+    cuda_data.h_haar_L.push_front(cuda_data.h_haar_L.front());	// primera posición coincide con el número de datos de escala
+}
+
+// ************************************************************************************************
+size_t coeficientes_haar(size_t datos, int niveles, int &aplicados)
+{
+    size_t num = datos;
+
+    aplicados = 0;
+    while (aplicados < niveles && num >= 2)
+    {
+        num = (num + 1) / 2;
+        aplicados++;
+    }
+
+    return num;
+}
+
+// ************************************************************************************************
+// coeficientes de la fila s en la ventana [inicio, inicio + datos) tras 'aplicados' niveles,
+// sumando cada posición metilada en su tramo
+static void haar_fila(const matriz_dispersa &matriz, size_t s, size_t inicio, size_t datos,
+                      size_t coeficientes, int aplicados, float escala, vector<float> &coeficiente)
+{
+    coeficiente.assign(coeficientes, 0.0f);
+
+    // primer dato de la fila dentro de la ventana
+    auto primero = matriz.columna.begin() + long(matriz.fila[s]);
+    auto ultimo  = matriz.columna.begin() + long(matriz.fila[s + 1]);
+    primero = lower_bound(primero, ultimo, uint32_t(matriz.origen + inicio));
+
+    for (size_t k = size_t(primero - matriz.columna.begin()); k < matriz.fila[s + 1]; k++)
+    {
+        size_t columna = matriz.columna[k] - matriz.origen - inicio;
+        if (columna >= datos)
+            break;
+
+        coeficiente[columna >> aplicados] += matriz.valor[k] * escala;
+    }
+}
+
+// ************************************************************************************************
+size_t haar_disperso(const matriz_dispersa &matriz, size_t inicio, size_t datos, int niveles,
+                     vector<vector<float>> &salida, unsigned hilos)
+{
+    int    aplicados    = 0;
+    size_t coeficientes = coeficientes_haar(datos, niveles, aplicados);
+
+    // cada nivel escala la suma de cada pareja por 1/√2
+    float escala = float(pow(sqrt(0.5), aplicados));
+
+    salida.resize(matriz.filas());
+
+    reparte_hilos(matriz.filas(), hilos, [&](size_t ini, size_t fin, unsigned)
+    {
+        for (size_t s = ini; s < fin; s++)
+            haar_fila(matriz, s, inicio, datos, coeficientes, aplicados, escala, salida[s]);
+    });
+
+    return coeficientes;
+}
+
+// ************************************************************************************************
+void indice_acumulado::construye(const matriz_dispersa &matriz, unsigned hilos)
+{
+    suma.resize(matriz.columna.size() + matriz.filas());
+
+    reparte_hilos(matriz.filas(), hilos, [&](size_t ini, size_t fin, unsigned)
+    {
+        for (size_t s = ini; s < fin; s++)
+        {
+            double total = 0.0;
+            for (size_t k = matriz.fila[s]; k < matriz.fila[s + 1]; k++)
+            {
+                suma[k + s] = total;
+                total      += matriz.valor[k];
+            }
+            suma[matriz.fila[s + 1] + s] = total;
+        }
+    });
+}
+
+// ************************************************************************************************
+size_t haar_acumulado(const matriz_dispersa &matriz, const indice_acumulado &indice, size_t inicio, size_t datos,
+                      int niveles, vector<vector<float>> &salida, unsigned hilos)
+{
+    int    aplicados    = 0;
+    size_t coeficientes = coeficientes_haar(datos, niveles, aplicados);
+    double escala       = pow(sqrt(0.5), aplicados);
+
+    salida.resize(matriz.filas());
+
+    reparte_hilos(matriz.filas(), hilos, [&](size_t ini, size_t fin, unsigned)
+    {
+        for (size_t s = ini; s < fin; s++)
+        {
+            vector<float> &coeficiente = salida[s];
+            coeficiente.resize(coeficientes);
+
+            const uint32_t *columna = matriz.columna.data();
+            const double   *suma    = indice.suma.data() + s;
+            size_t          final   = matriz.fila[s + 1];
+
+            // primer dato de la fila dentro de la ventana
+            size_t k = size_t(lower_bound(columna + matriz.fila[s], columna + final,
+                                          uint32_t(matriz.origen + inicio)) - columna);
+
+            for (size_t j = 0; j < coeficientes; j++)
+            {
+                // columna (absoluta) en que termina el tramo del coeficiente j
+                size_t   limite = min(inicio + ((j + 1) << aplicados), inicio + datos);
+                uint32_t tope   = uint32_t(matriz.origen + limite);
+
+                // búsqueda exponencial del primer dato del tramo siguiente
+                size_t desde = k;
+                size_t salto = 1;
+                while (desde + salto < final && columna[desde + salto - 1] < tope)
+                {
+                    desde += salto;
+                    salto *= 2;
+                }
+                size_t siguiente = size_t(lower_bound(columna + desde, columna + min(desde + salto, final), tope) - columna);
+
+                coeficiente[j] = float((suma[siguiente] - suma[k]) * escala);
+                k = siguiente;
+            }
+        }
+    });
+
+    return coeficientes;
+}
+
+// ************************************************************************************************
+float prepara_dibujo(const vector<vector<float>> &coeficientes, size_t num, vector<float> &vertices)
+{
+    float maximo = 0.0f;
+    for (const auto &fila : coeficientes)
+        maximo = valor_maximo(fila.data(), min(num, fila.size()), maximo);
+
+    // sin datos se dibuja a cero en lugar de dividir por cero
+    float escala = (maximo > 0.0f) ? float(AJUSTE_PLOT) / maximo : 0.0f;
+
+    vertices.resize(coeficientes.size() * num * 4);
+    for (size_t hilo = 0; hilo < coeficientes.size(); hilo++)
+        for (size_t index = 0; index < num; index++)
+        {
+            size_t idx = hilo * num + index;
+            float  y   = ((index < coeficientes[hilo].size()) ? coeficientes[hilo][index] : 0.0f) * escala - float(DESPLAZAMIENTO_DIBUJO);
+
+            vertices[idx * 4]     = float(index * 2.0 / num - DESPLAZAMIENTO_DIBUJO);        // eje x de -1 a 1
+            vertices[idx * 4 + 1] = y;                                                      // eje y de 0 a 2
+            vertices[idx * 4 + 2] = float((index + 1) * 2.0 / num - DESPLAZAMIENTO_DIBUJO);  // eje x de -1 a 1
+            vertices[idx * 4 + 3] = y;                                                      // eje y de 0 a 2
+        }
+
+    return maximo;
+}
+
+// ************************************************************************************************
+double suma_tramo(const matriz_dispersa &matriz, const indice_acumulado &indice, size_t s, size_t desde, size_t hasta)
+{
+    const uint32_t *primero = matriz.columna.data() + matriz.fila[s];
+    const uint32_t *ultimo  = matriz.columna.data() + matriz.fila[s + 1];
+
+    size_t a = size_t(lower_bound(primero, ultimo, uint32_t(matriz.origen + desde)) - matriz.columna.data());
+    size_t b = size_t(lower_bound(primero, ultimo, uint32_t(matriz.origen + hasta)) - matriz.columna.data());
+
+    return indice.suma[b + s] - indice.suma[a + s];
+}
+
+// ************************************************************************************************
+void piramide_haar::construye(const matriz_dispersa &matriz, size_t datos_, unsigned hilos)
+{
+    clear();
+    datos = datos_;
+
+    // último nivel posible: el que deja un solo coeficiente
+    int maximo = 0;
+    coeficientes_haar(datos, 64, maximo);
+    if (maximo < 1 || matriz.filas() == 0)
+        return;
+
+    // nivel base: el primero con no más coeficientes por muestra que posiciones metiladas por muestra
+    size_t sitios    = matriz.columna.size() / matriz.filas();
+    int    aplicados = 0;
+    base = 1;
+    while (base < maximo && coeficientes_haar(datos, base, aplicados) > sitios)
+        base++;
+
+    nivel.resize(size_t(maximo - base + 1));
+    for (auto &n : nivel)
+        n.resize(matriz.filas());
+
+    size_t coeficientes = coeficientes_haar(datos, base, aplicados);
+    float  escala       = float(pow(sqrt(0.5), base));
+    float  f            = float(sqrt(0.5));
+
+    reparte_hilos(matriz.filas(), hilos, [&](size_t ini, size_t fin, unsigned)
+    {
+        for (size_t s = ini; s < fin; s++)
+        {
+            // nivel base directamente desde las posiciones metiladas
+            haar_fila(matriz, s, 0, datos, coeficientes, base, escala, nivel[0][s]);
+
+            // el resto de niveles en una sola pasada por teselas del nivel base
+            vector<float *> destino(nivel.size() - 1);
+            for (size_t n = 1; n < nivel.size(); n++)
+            {
+                nivel[n][s].resize((nivel[n - 1][s].size() + 1) / 2);
+                destino[n - 1] = nivel[n][s].data();
+            }
+            niveles_haar(nivel[0][s].data(), nivel[0][s].size(), f, destino.data(), destino.size());
+        }
+    });
+}
+
+// ************************************************************************************************
+void piramide_haar::clear()
+{
+    datos       = 0;
+    base        = 0;
+    nivel_cache = -1;
+    vector<vector<vector<float>>>().swap(nivel);
+    vector<vector<float>>().swap(cache);
+}
+
+// ************************************************************************************************
+size_t piramide_haar::bytes() const
+{
+    size_t total = 0;
+    for (const auto &n : nivel)
+        for (const auto &fila : n)
+            total += fila.size() * sizeof(float);
+    for (const auto &fila : cache)
+        total += fila.size() * sizeof(float);
+
+    return total;
+}
+
+// ************************************************************************************************
+const vector<vector<float>> &piramide_haar::coeficientes(const matriz_dispersa &matriz, int L, unsigned hilos)
+{
+    // el nivel pedido puede no aplicarse completo si el cromosoma es corto
+    int aplicados = 0;
+    coeficientes_haar(datos, L, aplicados);
+
+    if (contiene(aplicados))
+        return nivel[size_t(aplicados - base)];
+
+    if (nivel_cache != aplicados)
+    {
+        haar_disperso(matriz, 0, datos, aplicados, cache, hilos);
+        nivel_cache = aplicados;
+    }
+
+    return cache;
+}
+
+// ************************************************************************************************
+size_t piramide_haar::ventana(const matriz_dispersa &matriz, const indice_acumulado &indice, size_t inicio, size_t datos_ventana,
+                              int niveles, vector<vector<float>> &salida, unsigned hilos) const
+{
+    int    aplicados    = 0;
+    size_t coeficientes = coeficientes_haar(datos_ventana, niveles, aplicados);
+    size_t tramo        = size_t(1) << aplicados;
+
+    if (!contiene(aplicados) || (inicio & (tramo - 1)) != 0)
+        return haar_acumulado(matriz, indice, inicio, datos_ventana, niveles, salida, hilos);
+
+    const vector<vector<float>> &piso  = nivel[size_t(aplicados - base)];
+    size_t                       desde = inicio >> aplicados;
+    double                       escala = pow(sqrt(0.5), aplicados);
+
+    salida.resize(matriz.filas());
+    for (size_t s = 0; s < matriz.filas(); s++)
+    {
+        vector<float> &coeficiente = salida[s];
+        coeficiente.assign(coeficientes, 0.0f);
+
+        const vector<float> &fila = piso[s];
+        if (desde < fila.size())
+            copy(fila.begin() + long(desde), fila.begin() + long(min(desde + coeficientes, fila.size())), coeficiente.begin());
+
+        // el último tramo queda cortado si la ventana no termina en múltiplo de 2^L
+        if ((datos_ventana & (tramo - 1)) != 0 && coeficientes > 0)
+        {
+            size_t ultimo = inicio + (coeficientes - 1) * tramo;
+            coeficiente.back() = float(suma_tramo(matriz, indice, s, ultimo, inicio + datos_ventana) * escala);
+        }
+    }
+
+    return coeficientes;
+}
@@ -0,0 +1,160 @@
+#ifndef HAAR_CPU_H
+#define HAAR_CPU_H
+
+#include "data_pack.h"
+
+/** ***********************************************************************************************
+  * \fn void calculo_haar_L(datos_cuda &cuda_data)
+  *  \brief Función para calcular el número de datos en el nivel dado y el ajuste por impares
+  *  \param &cuda_data  estructura con variables de control de datos
+  * ***********************************************************************************************
+  */
+void calculo_haar_L(datos_cuda &cuda_data);
+
+/** ***********************************************************************************************
+  * \fn size_t coeficientes_haar(size_t, int, int &)
+  *  \brief Calcula el número de coeficientes de aproximación que deja la transformada haar de
+  *         'datos' posiciones tras 'niveles' niveles, con el mismo criterio que wavedec: se
+  *         transforma mientras queden al menos dos datos y cada nivel redondea al alza
+  *  \param datos       número de posiciones a transformar
+  *  \param niveles     número de niveles solicitados
+  *  \param &aplicados  número de niveles que realmente se aplican
+  *  \return            número de coeficientes por muestra, ceil(datos / 2^aplicados)
+  * ***********************************************************************************************
+  */
+size_t coeficientes_haar(size_t datos, int niveles, int &aplicados);
+
+/** ***********************************************************************************************
+  * \fn size_t haar_disperso(const matriz_dispersa &, size_t, size_t, int, vector<vector<float>> &, unsigned)
+  *  \brief Transformada haar (aproximación) de cada fila de la matriz dispersa sin formar la
+  *         matriz completa. El coeficiente j del nivel L es la suma de los datos de las
+  *         posiciones [j·2^L, (j+1)·2^L) de la ventana escalada por (1/√2)^L, por lo que basta
+  *         una pasada por las posiciones metiladas de cada muestra: O(posiciones + coeficientes)
+  *  \param &matriz     matriz dispersa con una fila por muestra
+  *  \param inicio      primera columna de la ventana a transformar (relativa a matriz.origen)
+  *  \param datos       número de columnas de la ventana
+  *  \param niveles     número de niveles a transformar
+  *  \param &salida     coeficientes de cada muestra (filas x coeficientes)
+  *  \param hilos       número de hilos a utilizar
+  *  \return            número de coeficientes por muestra
+  * ***********************************************************************************************
+  */
+size_t haar_disperso(const matriz_dispersa &matriz, size_t inicio, size_t datos, int niveles,
+                     vector<vector<float>> &salida, unsigned hilos);
+
+/** ***********************************************************************************************
+  *  \brief suma acumulada de los valores de cada fila de una matriz dispersa: la suma de una
+  *         fila entre dos columnas cualesquiera es la diferencia de dos entradas, por lo que
+  *         cualquier coeficiente de aproximación de cualquier nivel y ventana se obtiene en O(1)
+  *         una vez localizados sus límites
+  *  \param suma    la fila s ocupa [fila[s] + s, fila[s + 1] + s]; suma[k + s] es la suma de los
+  *                 valores de la fila anteriores al dato k
+  * ***********************************************************************************************
+  */
+struct indice_acumulado
+{
+    vector<double> suma;
+
+    void   construye(const matriz_dispersa &matriz, unsigned hilos);
+    void   clear() { vector<double>().swap(suma); }
+    size_t bytes() const { return suma.size() * sizeof(double); }
+};
+
+/** ***********************************************************************************************
+  * \fn size_t haar_acumulado(const matriz_dispersa &, const indice_acumulado &, size_t, size_t, int, vector<vector<float>> &, unsigned)
+  *  \brief Igual que haar_disperso pero calcula cada coeficiente como diferencia de sumas
+  *         acumuladas, localizando el final de cada tramo por búsqueda exponencial desde el
+  *         anterior: el coste depende del número de coeficientes y no del ancho de la ventana
+  *  \param &matriz     matriz dispersa con una fila por muestra
+  *  \param &indice     suma acumulada de la matriz
+  *  \param inicio      primera columna de la ventana a transformar (relativa a matriz.origen)
+  *  \param datos       número de columnas de la ventana
+  *  \param niveles     número de niveles a transformar
+  *  \param &salida     coeficientes de cada muestra (filas x coeficientes)
+  *  \param hilos       número de hilos a utilizar
+  *  \return            número de coeficientes por muestra
+  * ***********************************************************************************************
+  */
+size_t haar_acumulado(const matriz_dispersa &matriz, const indice_acumulado &indice, size_t inicio, size_t datos,
+                      int niveles, vector<vector<float>> &salida, unsigned hilos);
+
+/** ***********************************************************************************************
+  * \fn float prepara_dibujo(const vector<vector<float>> &, size_t, vector<float> &)
+  *  \brief Genera los vértices de la gráfica en escalón de los coeficientes de todas las muestras
+  *         con el mismo formato que array2Plot: cuatro valores (x, y, x, y) por coeficiente,
+  *         escalados por el máximo de todas las muestras
+  *  \param &coeficientes   coeficientes de cada muestra
+  *  \param num             coeficientes por muestra a dibujar
+  *  \param &vertices       vértices de la gráfica (muestras x num x 4)
+  *  \return                valor máximo de los coeficientes
+  * ***********************************************************************************************
+  */
+float prepara_dibujo(const vector<vector<float>> &coeficientes, size_t num, vector<float> &vertices);
+
+/** ***********************************************************************************************
+  * \fn double suma_tramo(const matriz_dispersa &, const indice_acumulado &, size_t, size_t, size_t)
+  *  \brief Suma de los valores de la fila s en las columnas [desde, hasta) (relativas a origen)
+  * ***********************************************************************************************
+  */
+double suma_tramo(const matriz_dispersa &matriz, const indice_acumulado &indice, size_t s, size_t desde, size_t hasta);
+
+/** ***********************************************************************************************
+  *  \brief pirámide de coeficientes de aproximación de todas las muestras sobre el cromosoma
+  *         completo, desde un nivel base hasta el último nivel posible, de modo que los cambios
+  *         de nivel en la visualización y en la detección de DMRs son consultas. El nivel base
+  *         es el primero cuyos coeficientes no superan las posiciones metiladas de la matriz, de
+  *         modo que la pirámide ocupa como mucho el doble que los datos; los niveles inferiores
+  *         se calculan al pedirlos y se guarda el último en caché
+  *  \param datos       columnas del cromosoma completo (desde la columna 0)
+  *  \param base        primer nivel de la pirámide
+  *  \param nivel       coeficientes de cada nivel desde base: nivel[L - base][muestra][coeficiente]
+  *  \param nivel_cache nivel inferior a base guardado en cache (-1 si no hay)
+  *  \param cache       coeficientes del nivel en caché
+  * ***********************************************************************************************
+  */
+struct piramide_haar
+{
+    size_t                        datos       = 0;
+    int                           base        = 0;
+    vector<vector<vector<float>>> nivel;
+    int                           nivel_cache = -1;
+    vector<vector<float>>         cache;
+
+    /** ***********************************************************************************************
+      * \fn void construye(const matriz_dispersa &, size_t, unsigned)
+      *  \brief Construye todos los niveles en una sola pasada por muestra: el nivel base a partir
+      *         de las posiciones metiladas y cada nivel siguiente sumando parejas del anterior
+      *  \param &matriz     matriz dispersa con una fila por muestra
+      *  \param datos       columnas del cromosoma completo
+      *  \param hilos       número de hilos a utilizar
+      * ***********************************************************************************************
+      */
+    void construye(const matriz_dispersa &matriz, size_t datos, unsigned hilos);
+
+    void clear();
+
+    bool   contiene(int L) const { return L >= base && L < base + int(nivel.size()); }
+    size_t bytes() const;
+
+    /** ***********************************************************************************************
+      * \fn const vector<vector<float>> &coeficientes(const matriz_dispersa &, int, unsigned)
+      *  \brief Coeficientes de todas las muestras en el nivel L sobre el cromosoma completo
+      *         (de la pirámide, de la caché o calculados y guardados en caché)
+      * ***********************************************************************************************
+      */
+    const vector<vector<float>> &coeficientes(const matriz_dispersa &matriz, int L, unsigned hilos);
+
+    /** ***********************************************************************************************
+      * \fn size_t ventana(const matriz_dispersa &, const indice_acumulado &, size_t, size_t, int, vector<vector<float>> &, unsigned)
+      *  \brief Coeficientes de la ventana [inicio, inicio + datos) en el nivel solicitado, iguales
+      *         a los de haar_acumulado. Si el nivel está en la pirámide y la ventana empieza en un
+      *         múltiplo de 2^L se copian de la pirámide (el último se recalcula si el tramo queda
+      *         cortado por el final de la ventana); en otro caso se usan las sumas acumuladas
+      *  \return    número de coeficientes por muestra
+      * ***********************************************************************************************
+      */
+    size_t ventana(const matriz_dispersa &matriz, const indice_acumulado &indice, size_t inicio, size_t datos,
+                   int niveles, vector<vector<float>> &salida, unsigned hilos) const;
+};
+
+#endif // HAAR_CPU_H
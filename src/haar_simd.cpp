@@ -0,0 +1,397 @@
+#include "haar_simd.h"
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAAR_SIMD_X86
+#endif
+
+using namespace std;
+
+// ************************************************************************************************
+// versión escalar: referencia y resto de las versiones vectoriales
+static void suma_parejas_escalar(const float *entrada, size_t n, float factor, float *salida)
+{
+    size_t j = 0;
+    for (; 2 * j + 1 < n; j++)
+        salida[j] = (entrada[2 * j] + entrada[2 * j + 1]) * factor;
+    if (n & 1)
+        salida[j] = (entrada[2 * j] + 0.0f) * factor;
+}
+
+// ************************************************************************************************
+static float valor_maximo_escalar(const float *datos, size_t n, float inicial)
+{
+    float maximo = inicial;
+    for (size_t i = 0; i < n; i++)
+        maximo = max(maximo, datos[i]);
+
+    return maximo;
+}
+
+// ************************************************************************************************
+static void acumula_region_escalar(const float *valores, const uint32_t *sitios, size_t n, uint32_t minimo,
+                                   float *suma, float *desviacion, uint32_t *numero)
+{
+    for (size_t k = 0; k < n; k++)
+        if (sitios[k] >= minimo)
+        {
+            // Welford sobre la suma: la desviación crece (x - media anterior) · (x - media nueva)
+            float anterior = suma[k] / float(max(numero[k], 1u));
+            suma[k] += valores[k];
+            numero[k]++;
+            desviacion[k] += (valores[k] - anterior) * (valores[k] - suma[k] / float(numero[k]));
+        }
+}
+
+// ************************************************************************************************
+// sitios de cada región [desde, hasta) con la presencia de una muestra: popcount de la parte de la
+// primera palabra, palabras intermedias con el acumulado y popcount de la parte de la última palabra
+static inline __attribute__((always_inline))
+void sitios_regiones_cuerpo(const uint64_t *presencia, const uint32_t *acumulado, const size_t *desde,
+                            const size_t *hasta, size_t n, size_t ultimo, uint32_t *sitios)
+{
+    for (size_t k = 0; k < n; k++)
+    {
+        size_t   d      = desde[k];
+        size_t   h      = hasta[k];
+        uint32_t cuenta = 0;
+
+        if (h > d)
+        {
+            size_t   primera = d >> 6;
+            size_t   final   = (h - 1) >> 6;
+            uint64_t bits    = presencia[primera] >> (d & 63);
+
+            if (primera == final)
+                cuenta = uint32_t(__builtin_popcountll(bits & (~uint64_t(0) >> (64 - (h - d)))));
+            else
+                cuenta = uint32_t(__builtin_popcountll(bits)) + (acumulado[final] - acumulado[primera + 1]) +
+                         uint32_t(__builtin_popcountll(presencia[final] << (63 - ((h - 1) & 63))));
+        }
+
+        // la última posición de la muestra no se tiene en cuenta
+        sitios[k] = cuenta - uint32_t(cuenta > 0 && ultimo >= d && ultimo < h);
+    }
+}
+
+// ************************************************************************************************
+static void sitios_regiones_escalar(const uint64_t *presencia, const uint32_t *acumulado, const size_t *desde,
+                                    const size_t *hasta, size_t n, size_t ultimo, uint32_t *sitios)
+{
+    sitios_regiones_cuerpo(presencia, acumulado, desde, hasta, n, ultimo, sitios);
+}
+
+#ifdef HAAR_SIMD_X86
+// ************************************************************************************************
+// mismo cuerpo con la instrucción POPCNT en lugar del popcount por software de libgcc
+__attribute__((target("popcnt")))
+static void sitios_regiones_popcnt(const uint64_t *presencia, const uint32_t *acumulado, const size_t *desde,
+                                   const size_t *hasta, size_t n, size_t ultimo, uint32_t *sitios)
+{
+    sitios_regiones_cuerpo(presencia, acumulado, desde, hasta, n, ultimo, sitios);
+}
+
+// ************************************************************************************************
+// SSE2: 4 coeficientes por iteración separando pares e impares de dos registros
+__attribute__((target("sse2")))
+static void suma_parejas_sse2(const float *entrada, size_t n, float factor, float *salida)
+{
+    const __m128 f = _mm_set1_ps(factor);
+    size_t j = 0;
+    for (; 2 * j + 8 <= n; j += 4)
+    {
+        __m128 a = _mm_loadu_ps(entrada + 2 * j);
+        __m128 b = _mm_loadu_ps(entrada + 2 * j + 4);
+        __m128 pares   = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 impares = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        _mm_storeu_ps(salida + j, _mm_mul_ps(_mm_add_ps(pares, impares), f));
+    }
+    suma_parejas_escalar(entrada + 2 * j, n - 2 * j, factor, salida + j);
+}
+
+// ************************************************************************************************
+__attribute__((target("sse2")))
+static float valor_maximo_sse2(const float *datos, size_t n, float inicial)
+{
+    __m128 m = _mm_set1_ps(inicial);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+        m = _mm_max_ps(m, _mm_loadu_ps(datos + i));
+
+    m = _mm_max_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 0, 3, 2)));
+    m = _mm_max_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(2, 3, 0, 1)));
+
+    return valor_maximo_escalar(datos + i, n - i, _mm_cvtss_f32(m));
+}
+
+// ************************************************************************************************
+// los sitios son menores que 2^31, así que sitios >= minimo equivale a sitios > minimo - 1 con signo;
+// las regiones que no cumplen suman +0.0, que no altera la suma (que nunca es -0.0)
+__attribute__((target("sse2")))
+static void acumula_region_sse2(const float *valores, const uint32_t *sitios, size_t n, uint32_t minimo,
+                                float *suma, float *desviacion, uint32_t *numero)
+{
+    const __m128i umbral = _mm_set1_epi32(int(minimo) - 1);
+    const __m128i cero   = _mm_setzero_si128();
+    const __m128i uno    = _mm_set1_epi32(1);
+    size_t k = 0;
+    for (; k + 4 <= n; k += 4)
+    {
+        __m128i valido = _mm_cmpgt_epi32(_mm_loadu_si128((const __m128i *)(sitios + k)), umbral);
+        __m128  x      = _mm_loadu_ps(valores + k);
+        __m128  s      = _mm_loadu_ps(suma + k);
+        __m128i c      = _mm_loadu_si128((const __m128i *)(numero + k));
+
+        // max(c, 1) sin SSE4.1: c nunca es negativo
+        __m128 anterior = _mm_div_ps(s, _mm_cvtepi32_ps(_mm_or_si128(c, _mm_and_si128(_mm_cmpeq_epi32(c, cero), uno))));
+        s = _mm_add_ps(s, _mm_and_ps(_mm_castsi128_ps(valido), x));
+        c = _mm_sub_epi32(c, valido);
+        __m128 nueva    = _mm_div_ps(s, _mm_cvtepi32_ps(_mm_or_si128(c, _mm_and_si128(_mm_cmpeq_epi32(c, cero), uno))));
+        __m128 d        = _mm_mul_ps(_mm_sub_ps(x, anterior), _mm_sub_ps(x, nueva));
+
+        _mm_storeu_ps(suma + k, s);
+        _mm_storeu_si128((__m128i *)(numero + k), c);
+        _mm_storeu_ps(desviacion + k, _mm_add_ps(_mm_loadu_ps(desviacion + k), _mm_and_ps(_mm_castsi128_ps(valido), d)));
+    }
+    acumula_region_escalar(valores + k, sitios + k, n - k, minimo, suma + k, desviacion + k, numero + k);
+}
+
+// ************************************************************************************************
+// AVX2: suma horizontal de parejas y reordenación de los carriles de 128 bits
+__attribute__((target("avx2")))
+static void suma_parejas_avx2(const float *entrada, size_t n, float factor, float *salida)
+{
+    const __m256 f = _mm256_set1_ps(factor);
+    size_t j = 0;
+    for (; 2 * j + 16 <= n; j += 8)
+    {
+        __m256 a = _mm256_loadu_ps(entrada + 2 * j);
+        __m256 b = _mm256_loadu_ps(entrada + 2 * j + 8);
+        // [a01 a23 b01 b23 | a45 a67 b45 b67] -> [a01 a23 a45 a67 | b01 b23 b45 b67]
+        __m256 s = _mm256_hadd_ps(a, b);
+        s = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(s), _MM_SHUFFLE(3, 1, 2, 0)));
+        _mm256_storeu_ps(salida + j, _mm256_mul_ps(s, f));
+    }
+    // deja limpia la parte alta de los registros antes del resto en código SSE (evita la penalización de transición)
+    _mm256_zeroupper();
+    suma_parejas_escalar(entrada + 2 * j, n - 2 * j, factor, salida + j);
+}
+
+// ************************************************************************************************
+__attribute__((target("avx2")))
+static float valor_maximo_avx2(const float *datos, size_t n, float inicial)
+{
+    __m256 m = _mm256_set1_ps(inicial);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+        m = _mm256_max_ps(m, _mm256_loadu_ps(datos + i));
+
+    __m128 r = _mm_max_ps(_mm256_castps256_ps128(m), _mm256_extractf128_ps(m, 1));
+    r = _mm_max_ps(r, _mm_shuffle_ps(r, r, _MM_SHUFFLE(1, 0, 3, 2)));
+    r = _mm_max_ps(r, _mm_shuffle_ps(r, r, _MM_SHUFFLE(2, 3, 0, 1)));
+
+    float maximo = _mm_cvtss_f32(r);
+    _mm256_zeroupper();
+
+    return valor_maximo_escalar(datos + i, n - i, maximo);
+}
+
+// ************************************************************************************************
+__attribute__((target("avx2")))
+static void acumula_region_avx2(const float *valores, const uint32_t *sitios, size_t n, uint32_t minimo,
+                                float *suma, float *desviacion, uint32_t *numero)
+{
+    const __m256i umbral = _mm256_set1_epi32(int(minimo) - 1);
+    const __m256i uno    = _mm256_set1_epi32(1);
+    size_t k = 0;
+    for (; k + 8 <= n; k += 8)
+    {
+        __m256i valido = _mm256_cmpgt_epi32(_mm256_loadu_si256((const __m256i *)(sitios + k)), umbral);
+        __m256  x      = _mm256_loadu_ps(valores + k);
+        __m256  s      = _mm256_loadu_ps(suma + k);
+        __m256i c      = _mm256_loadu_si256((const __m256i *)(numero + k));
+
+        __m256 anterior = _mm256_div_ps(s, _mm256_cvtepi32_ps(_mm256_max_epu32(c, uno)));
+        s = _mm256_add_ps(s, _mm256_and_ps(_mm256_castsi256_ps(valido), x));
+        c = _mm256_sub_epi32(c, valido);
+        __m256 nueva    = _mm256_div_ps(s, _mm256_cvtepi32_ps(_mm256_max_epu32(c, uno)));
+        __m256 d        = _mm256_mul_ps(_mm256_sub_ps(x, anterior), _mm256_sub_ps(x, nueva));
+
+        _mm256_storeu_ps(suma + k, s);
+        _mm256_storeu_si256((__m256i *)(numero + k), c);
+        _mm256_storeu_ps(desviacion + k, _mm256_add_ps(_mm256_loadu_ps(desviacion + k), _mm256_and_ps(_mm256_castsi256_ps(valido), d)));
+    }
+    _mm256_zeroupper();
+    acumula_region_escalar(valores + k, sitios + k, n - k, minimo, suma + k, desviacion + k, numero + k);
+}
+
+// ************************************************************************************************
+// AVX-512: pares e impares de dos registros con una permutación de dos fuentes
+__attribute__((target("avx512f")))
+static void suma_parejas_avx512(const float *entrada, size_t n, float factor, float *salida)
+{
+    const __m512  f       = _mm512_set1_ps(factor);
+    const __m512i pares   = _mm512_set_epi32(30, 28, 26, 24, 22, 20, 18, 16, 14, 12, 10, 8, 6, 4, 2, 0);
+    const __m512i impares = _mm512_set_epi32(31, 29, 27, 25, 23, 21, 19, 17, 15, 13, 11, 9, 7, 5, 3, 1);
+    size_t j = 0;
+    for (; 2 * j + 32 <= n; j += 16)
+    {
+        __m512 a = _mm512_loadu_ps(entrada + 2 * j);
+        __m512 b = _mm512_loadu_ps(entrada + 2 * j + 16);
+        __m512 s = _mm512_add_ps(_mm512_permutex2var_ps(a, pares, b), _mm512_permutex2var_ps(a, impares, b));
+        _mm512_storeu_ps(salida + j, _mm512_mul_ps(s, f));
+    }
+    _mm256_zeroupper();
+    suma_parejas_escalar(entrada + 2 * j, n - 2 * j, factor, salida + j);
+}
+
+// ************************************************************************************************
+__attribute__((target("avx512f")))
+static float valor_maximo_avx512(const float *datos, size_t n, float inicial)
+{
+    // las formas con máscara evitan el registro "undefined" que gcc avisa como no inicializado
+    __m512 m = _mm512_set1_ps(inicial);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+        m = _mm512_mask_max_ps(m, 0xFFFF, m, _mm512_loadu_ps(datos + i));
+
+    float carril[16];
+    _mm512_storeu_ps(carril, m);
+
+    _mm256_zeroupper();
+
+    return valor_maximo_escalar(datos + i, n - i, valor_maximo_escalar(carril, 16, inicial));
+}
+
+// ************************************************************************************************
+__attribute__((target("avx512f")))
+static void acumula_region_avx512(const float *valores, const uint32_t *sitios, size_t n, uint32_t minimo,
+                                  float *suma, float *desviacion, uint32_t *numero)
+{
+    const __m512i umbral = _mm512_set1_epi32(int(minimo) - 1);
+    const __m512i uno    = _mm512_set1_epi32(1);
+    size_t k = 0;
+    for (; k + 16 <= n; k += 16)
+    {
+        __mmask16 valido = _mm512_cmpgt_epi32_mask(_mm512_loadu_si512(sitios + k), umbral);
+        __m512    x      = _mm512_loadu_ps(valores + k);
+        __m512    s      = _mm512_loadu_ps(suma + k);
+        __m512    v      = _mm512_loadu_ps(desviacion + k);
+        __m512i   c      = _mm512_loadu_si512(numero + k);
+
+        // formas con máscara completa y origen explícito, como en valor_maximo_avx512
+        __m512 anterior = _mm512_div_ps(s, _mm512_mask_cvtepi32_ps(s, 0xFFFF, _mm512_mask_max_epu32(uno, 0xFFFF, c, uno)));
+        s = _mm512_mask_add_ps(s, valido, s, x);
+        c = _mm512_mask_add_epi32(c, valido, c, uno);
+        __m512 nueva    = _mm512_div_ps(s, _mm512_mask_cvtepi32_ps(s, 0xFFFF, _mm512_mask_max_epu32(uno, 0xFFFF, c, uno)));
+        __m512 d        = _mm512_mul_ps(_mm512_sub_ps(x, anterior), _mm512_sub_ps(x, nueva));
+
+        _mm512_storeu_ps(suma + k, s);
+        _mm512_storeu_si512(numero + k, c);
+        _mm512_storeu_ps(desviacion + k, _mm512_mask_add_ps(v, valido, v, d));
+    }
+    _mm256_zeroupper();
+    acumula_region_escalar(valores + k, sitios + k, n - k, minimo, suma + k, desviacion + k, numero + k);
+}
+#endif
+
+// ************************************************************************************************
+// variante elegida para el procesador en que se ejecuta
+struct nucleos_haar
+{
+    const char *nombre;
+    void  (*suma_parejas)(const float *, size_t, float, float *);
+    float (*valor_maximo)(const float *, size_t, float);
+    void  (*acumula_region)(const float *, const uint32_t *, size_t, uint32_t, float *, float *, uint32_t *);
+    void  (*sitios_regiones)(const uint64_t *, const uint32_t *, const size_t *, const size_t *, size_t, size_t, uint32_t *);
+};
+
+static nucleos_haar elige_nucleos()
+{
+    nucleos_haar elegidos = {"scalar", suma_parejas_escalar, valor_maximo_escalar, acumula_region_escalar,
+                             sitios_regiones_escalar};
+#ifdef HAAR_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        elegidos = {"AVX-512", suma_parejas_avx512, valor_maximo_avx512, acumula_region_avx512, sitios_regiones_escalar};
+    else if (__builtin_cpu_supports("avx2"))
+        elegidos = {"AVX2", suma_parejas_avx2, valor_maximo_avx2, acumula_region_avx2, sitios_regiones_escalar};
+    else if (__builtin_cpu_supports("sse2"))
+        elegidos = {"SSE2", suma_parejas_sse2, valor_maximo_sse2, acumula_region_sse2, sitios_regiones_escalar};
+
+    // POPCNT no va ligada a un nivel de SSE/AVX
+    if (__builtin_cpu_supports("popcnt"))
+        elegidos.sitios_regiones = sitios_regiones_popcnt;
+#endif
+    return elegidos;
+}
+
+static const nucleos_haar &nucleos()
+{
+    static const nucleos_haar elegidos = elige_nucleos();
+    return elegidos;
+}
+
+// ************************************************************************************************
+void suma_parejas(const float *entrada, size_t n, float factor, float *salida)
+{
+    nucleos().suma_parejas(entrada, n, factor, salida);
+}
+
+// ************************************************************************************************
+void niveles_haar(const float *entrada, size_t n, float factor, float *const *salida, size_t niveles)
+{
+    while (niveles > 0)
+    {
+        size_t fusion = min(niveles, size_t(TESELA_HAAR));
+        size_t tesela = size_t(1) << fusion;
+
+        // las teselas son múltiplo de 2^fusion, así que solo la última puede tener tramos impares
+        for (size_t inicio = 0; inicio < n; inicio += tesela)
+        {
+            const float *origen = entrada + inicio;
+            size_t       m      = min(tesela, n - inicio);
+
+            for (size_t l = 0; l < fusion; l++)
+            {
+                float *destino = salida[l] + (inicio >> (l + 1));
+                nucleos().suma_parejas(origen, m, factor, destino);
+                origen = destino;
+                m      = (m + 1) / 2;
+            }
+        }
+
+        for (size_t l = 0; l < fusion; l++)
+            n = (n + 1) / 2;
+        entrada  = salida[fusion - 1];
+        salida  += fusion;
+        niveles -= fusion;
+    }
+}
+
+// ************************************************************************************************
+float valor_maximo(const float *datos, size_t n, float inicial)
+{
+    return nucleos().valor_maximo(datos, n, inicial);
+}
+
+// ************************************************************************************************
+void acumula_region(const float *valores, const uint32_t *sitios, size_t n, uint32_t minimo, float *suma,
+                    float *desviacion, uint32_t *numero)
+{
+    nucleos().acumula_region(valores, sitios, n, minimo, suma, desviacion, numero);
+}
+
+// ************************************************************************************************
+void sitios_regiones(const uint64_t *presencia, const uint32_t *acumulado, const size_t *desde, const size_t *hasta,
+                     size_t n, size_t ultimo, uint32_t *sitios)
+{
+    nucleos().sitios_regiones(presencia, acumulado, desde, hasta, n, ultimo, sitios);
+}
+
+// ************************************************************************************************
+const char *juego_instrucciones()
+{
+    return nucleos().nombre;
+}
@@ -0,0 +1,94 @@
+#ifndef HAAR_SIMD_H
+#define HAAR_SIMD_H
+
+#include <cstddef>
+#include <cstdint>
+
+// niveles que se calculan juntos por tesela: 2^12 datos de entrada (16 KB) y sus niveles caben en L1
+#define TESELA_HAAR 12
+
+/** ***********************************************************************************************
+  *  \brief núcleos vectoriales de la transformada haar y del análisis de DMRs en CPU. Cada función
+  *         tiene una versión escalar, SSE2, AVX2 y AVX-512; la más rápida que admite el procesador
+  *         se elige una sola vez (CPUID) al primer uso, de modo que el mismo ejecutable aprovecha
+  *         cada nodo
+  * ***********************************************************************************************
+  */
+
+/** ***********************************************************************************************
+  * \fn void suma_parejas(const float *, size_t, float, float *)
+  *  \brief Un nivel de la aproximación haar: salida[j] = (entrada[2j] + entrada[2j + 1]) · factor;
+  *         con n impar el último dato se suma con cero
+  *  \param *entrada    datos del nivel anterior
+  *  \param n           número de datos de entrada
+  *  \param factor      escala del nivel (1/√2)
+  *  \param *salida     (n + 1) / 2 coeficientes; puede ser la propia entrada
+  * ***********************************************************************************************
+  */
+void suma_parejas(const float *entrada, size_t n, float factor, float *salida);
+
+/** ***********************************************************************************************
+  * \fn void niveles_haar(const float *, size_t, float, float *const *, size_t)
+  *  \brief Varios niveles de la aproximación haar en una sola pasada por memoria: la entrada se
+  *         recorre en teselas de 2^TESELA_HAAR datos y en cada una se calculan seguidos todos sus
+  *         niveles (cada uno a partir del anterior, todavía en caché), escribiendo cada nivel en
+  *         su salida; si se piden más niveles se repite sobre el último, ya 2^TESELA_HAAR menor
+  *  \param *entrada    datos de partida
+  *  \param n           número de datos de entrada
+  *  \param factor      escala de cada nivel (1/√2)
+  *  \param *salida     salida[l] recibe el nivel l + 1, con ceil(n / 2^(l + 1)) coeficientes
+  *  \param niveles     número de niveles a calcular
+  * ***********************************************************************************************
+  */
+void niveles_haar(const float *entrada, size_t n, float factor, float *const *salida, size_t niveles);
+
+/** ***********************************************************************************************
+  * \fn float valor_maximo(const float *, size_t, float)
+  *  \brief Máximo de n datos y del valor inicial (equivalente en CPU a maxVal/maxGlobal)
+  * ***********************************************************************************************
+  */
+float valor_maximo(const float *datos, size_t n, float inicial);
+
+/** ***********************************************************************************************
+  * \fn void acumula_region(const float *, const uint32_t *, size_t, uint32_t, float *, float *, uint32_t *)
+  *  \brief Acumula los coeficientes de una muestra en las regiones con sitios suficientes: si
+  *         sitios[k] >= minimo, suma[k] += valores[k], numero[k]++ y la suma de cuadrados de las
+  *         desviaciones a la media crece con la actualización de Welford, en la misma pasada
+  *         (sitios menores que 2^31)
+  *  \param *valores    coeficientes de la muestra en n regiones consecutivas
+  *  \param *sitios     posiciones metiladas de la muestra en cada región
+  *  \param n           número de regiones
+  *  \param minimo      sitios mínimos para tener en cuenta la región
+  *  \param *suma       suma de coeficientes de cada región
+  *  \param *desviacion suma de cuadrados de las desviaciones a la media de cada región
+  *  \param *numero     número de muestras sumadas en cada región
+  * ***********************************************************************************************
+  */
+void acumula_region(const float *valores, const uint32_t *sitios, size_t n, uint32_t minimo, float *suma,
+                    float *desviacion, uint32_t *numero);
+
+/** ***********************************************************************************************
+  * \fn void sitios_regiones(const uint64_t *, const uint32_t *, const size_t *, const size_t *, size_t, size_t, uint32_t *)
+  *  \brief Posiciones presentes de una muestra en cada tramo [desde[k], hasta[k]) del diccionario,
+  *         contadas con popcount sobre palabras de 64 bits de su mapa de presencia (con la
+  *         instrucción POPCNT si el procesador la tiene) y sin contar la última de la muestra
+  *  \param *presencia  mapa de presencia de la muestra
+  *  \param *acumulado  bits activos antes de cada palabra de presencia
+  *  \param *desde      primer índice del diccionario de cada región
+  *  \param *hasta      índice siguiente al último de cada región
+  *  \param n           número de regiones
+  *  \param ultimo      índice de la última posición presente de la muestra
+  *  \param *sitios     posiciones de la muestra en cada región
+  * ***********************************************************************************************
+  */
+void sitios_regiones(const uint64_t *presencia, const uint32_t *acumulado, const size_t *desde, const size_t *hasta,
+                     size_t n, size_t ultimo, uint32_t *sitios);
+
+/** ***********************************************************************************************
+  * \fn const char *juego_instrucciones()
+  *  \brief Nombre de la variante elegida: "scalar", "SSE2", "AVX2" o "AVX-512"
+  * ***********************************************************************************************
+  */
+const char *juego_instrucciones();
+
+#endif // HAAR_SIMD_H
@@ -37,10 +37,11 @@
 #include <cuda_runtime.h>
 #include <cuda_gl_interop.h>
 #include "data_pack.h"
+#include "haar_cpu.h"
+#include <algorithm>
+#include <cmath>
 
 #define BLOCK_SIZE  1024		// número de hilos por bloque de GPU
-#define AJUSTE_PLOT 1.70        // ajusta eje Y de gráfica a AJUSTE_PLOT
-#define DESPLAZAMIENTO_DIBUJO 0.98
 #define gpuErrchk(ans) { gpuAssert((ans), __FILE__, __LINE__); } // para gestión de errores en GPU
 
 
@@ -389,6 +390,144 @@ void wavedec(float *haar, float *aux, float *temp,
 	}
 }
 
+/** ***********************************************************************************************
+  * \fn void csr2full(float *, size_t, const size_t *, const uint32_t *, const float *, uint32_t)
+  *  \brief función en GPU responsable de colocar los datos de la matriz dispersa por filas (CSR)
+  *         en la matriz completa; cada fila de bloques (blockIdx.y) se encarga de una muestra
+  *  \param *haar      puntero a la matriz completa en GPU, inicializada a cero
+  *  \param pitch      desplazamiento en bytes entre filas de la matriz completa
+  *  \param *fila      inicio de cada fila en columna y valor
+  *  \param *columna   posición en el cromosoma de cada dato
+  *  \param *valor     valor de cada dato
+  *  \param origen     posición del cromosoma de la columna 0 de la matriz completa
+  * ***********************************************************************************************
+  */
+extern "C"
+__global__
+void csr2full(float *haar, size_t pitch, const size_t *fila, const uint32_t *columna, const float *valor, uint32_t origen)
+{
+    size_t muestra = blockIdx.y;
+    size_t k       = fila[muestra] + threadIdx.x + size_t(blockIdx.x) * blockDim.x;
+
+    if (k < fila[muestra + 1])
+    {
+        float *haar_c = (float *)((char *)haar + muestra * pitch);
+        haar_c[columna[k] - origen] = valor[k];
+    }
+}
+
+/** ***********************************************************************************************
+  * \fn void csr2tesela(float *, size_t, const size_t *, const uint32_t *, const float *, uint32_t)
+  *  \brief función en GPU responsable de colocar en la tesela los datos de la matriz dispersa
+  *         residente en GPU; cada fila de bloques (blockIdx.y) se encarga de una muestra
+  *  \param *haar      puntero a la tesela en GPU, inicializada a cero
+  *  \param pitch      desplazamiento en bytes entre filas de la tesela
+  *  \param *rango     primer dato y siguiente al último de cada muestra dentro de la tesela
+  *  \param *columna   posición en el cromosoma de cada dato
+  *  \param *valor     valor de cada dato
+  *  \param inicio     posición del cromosoma de la columna 0 de la tesela
+  * ***********************************************************************************************
+  */
+extern "C"
+__global__
+void csr2tesela(float *haar, size_t pitch, const size_t *rango, const uint32_t *columna, const float *valor, uint32_t inicio)
+{
+    size_t muestra = blockIdx.y;
+    size_t k       = rango[2 * muestra] + threadIdx.x + size_t(blockIdx.x) * blockDim.x;
+
+    if (k < rango[2 * muestra + 1])
+    {
+        float *haar_c = (float *)((char *)haar + muestra * pitch);
+        haar_c[columna[k] - inicio] = valor[k];
+    }
+}
+
+/** ***********************************************************************************************
+  * \fn void anota_espacio(espacio_gpu &, bool)
+  *  \brief Función para actualizar los contadores del espacio de trabajo de la GPU
+  *  \param &espacio    espacio de trabajo
+  *  \param crece       true si se ha tenido que reservar memoria
+  * ***********************************************************************************************
+  */
+static void anota_espacio(espacio_gpu &espacio, bool crece)
+{
+    if (!crece)
+    {
+        espacio.contadores.reutilizaciones++;
+        return;
+    }
+
+    size_t bytes = espacio.pitch * size_t(espacio.filas) + espacio.plot * sizeof(float) + espacio.rango * sizeof(size_t);
+    espacio.contadores.reservas++;
+    espacio.contadores.bytes = max(espacio.contadores.bytes, bytes);
+}
+
+/** ***********************************************************************************************
+  * \fn float *temporal_gpu(datos_cuda &, size_t, int, size_t &)
+  *  \brief Función para obtener la memoria temporal de wavedec del espacio de trabajo, reservándola
+  *         solo si la ya reservada no es suficiente
+  *  \param &cuda_data  estructura con variables de control de datos
+  *  \param ancho       bytes por fila necesarios
+  *  \param filas       número de filas necesarias
+  *  \param &pitch      desplazamiento entre filas de la memoria devuelta
+  *  \return            puntero a la memoria temporal en GPU
+  * ***********************************************************************************************
+  */
+static float *temporal_gpu(datos_cuda &cuda_data, size_t ancho, int filas, size_t &pitch)
+{
+    espacio_gpu &espacio = cuda_data.espacio;
+    bool crece = (espacio.d_temp == nullptr || ancho > espacio.ancho || filas > espacio.filas);
+
+    if (crece)
+    {
+        cudaFree(espacio.d_temp);
+        espacio.ancho = max(espacio.ancho, ancho);
+        espacio.filas = max(espacio.filas, filas);
+        gpuErrchk(cudaMallocPitch(&espacio.d_temp, &espacio.pitch, espacio.ancho, espacio.filas));
+    }
+    anota_espacio(espacio, crece);
+
+    pitch = espacio.pitch;
+    return espacio.d_temp;
+}
+
+/** ***********************************************************************************************
+  * \fn T *vector_gpu(espacio_gpu &, T *&, size_t &, size_t)
+  *  \brief Función para obtener un vector del espacio de trabajo de la GPU con al menos n elementos
+  * ***********************************************************************************************
+  */
+template <class T>
+static T *vector_gpu(espacio_gpu &espacio, T *&datos, size_t &capacidad, size_t n)
+{
+    bool crece = (datos == nullptr || n > capacidad);
+
+    if (crece)
+    {
+        cudaFree(datos);
+        capacidad = max(capacidad, n);
+        gpuErrchk(cudaMalloc(&datos, capacidad * sizeof(T)));
+    }
+    anota_espacio(espacio, crece);
+
+    return datos;
+}
+
+/** ***********************************************************************************************
+  * \fn void libera_espacio(espacio_gpu &)
+  *  \brief Función para liberar el espacio de trabajo de la GPU conservando sus contadores
+  * ***********************************************************************************************
+  */
+static void libera_espacio(espacio_gpu &espacio)
+{
+    cudaFree(espacio.d_temp);
+    cudaFree(espacio.d_plot);
+    cudaFree(espacio.d_rango);
+
+    contadores_espacio contadores = espacio.contadores;
+    espacio = espacio_gpu();
+    espacio.contadores = contadores;
+}
+
 /** ***********************************************************************************************
   * \fn void cuda_send_data(datos_cuda &)
   *  \brief Función para enviar los datos a la GPU
@@ -397,6 +536,23 @@ void wavedec(float *haar, float *aux, float *temp,
   */
 void cuda_send_data(datos_cuda &cuda_data)
 {
+    // modo por teselas: la matriz dispersa queda residente en GPU y solo se reserva una tesela
+    if (cuda_data.ancho_tesela > 0 && cuda_data.mc_csr != nullptr)
+    {
+        const matriz_dispersa &matriz = *cuda_data.mc_csr;
+        size_t datos = matriz.columna.size();
+
+        gpuErrchk(cudaMallocPitch(&cuda_data.d_haar, &cuda_data.pitch,   (cuda_data.ancho_tesela + 2) * sizeof(float), cuda_data.samples));
+        gpuErrchk(cudaMallocPitch(&cuda_data.d_aux,  &cuda_data.pitch_2, (cuda_data.ancho_tesela + 2) * sizeof(float), cuda_data.samples));
+
+        gpuErrchk(cudaMalloc(&cuda_data.d_columna, (datos + 1) * sizeof(uint32_t)));
+        gpuErrchk(cudaMalloc(&cuda_data.d_valor,   (datos + 1) * sizeof(float)));
+        gpuErrchk(cudaMemcpy(cuda_data.d_columna, matriz.columna.data(), datos * sizeof(uint32_t), cudaMemcpyHostToDevice));
+        gpuErrchk(cudaMemcpy(cuda_data.d_valor,   matriz.valor.data(),   datos * sizeof(float),    cudaMemcpyHostToDevice));
+
+        return;
+    }
+
     // reserva espacio en GPU para el vector a transformar y copia matriz de datos ----------------
     // devuelve valor de desplazamiento (pitch) óptimo para gestión de memoria adecuada
     // en función de la cantdad de datos a alojar
@@ -416,21 +572,44 @@ void cuda_send_data(datos_cuda &cuda_data)
                               cuda_data.samples));
 
 
-    // envío de datos a GPU -----------------------------------------------------------------------
-    // \param	puntero a posición de memoria GPU,
-    //          desplazamiento óptimo,
-    //          puntero a posición de datos en CPU a enviar a GPU,
-    //          cantidad de bytes a enviar por muestra,
-    //          cantidad de bytes a alojar por muestra,
-    //          número de filas (muestras)
-    gpuErrchk(cudaMemcpy2D( cuda_data.d_haar,
-                            cuda_data.pitch,
-                            cuda_data.mc_full[0],
-                            cuda_data.sample_num * sizeof(float),
-                            cuda_data.sample_num * sizeof(float),
-                            cuda_data.samples,
-                            cudaMemcpyHostToDevice));
+    // envío de datos a GPU como matriz dispersa ---------------------------------------------------
+    // solo se envían las posiciones metiladas y la matriz completa se rellena en la GPU
+    const matriz_dispersa &matriz = *cuda_data.mc_csr;
+
+    gpuErrchk(cudaMemset2D(cuda_data.d_haar,
+                           cuda_data.pitch,
+                           0,
+                           (cuda_data.sample_num + cuda_data.data_adjust) * sizeof(float),
+                           cuda_data.samples));
+
+    size_t   *d_fila;
+    uint32_t *d_columna;
+    float    *d_valor;
+    size_t    datos = matriz.columna.size();
+    gpuErrchk(cudaMalloc(&d_fila,    matriz.fila.size() * sizeof(size_t)));
+    gpuErrchk(cudaMalloc(&d_columna, (datos + 1) * sizeof(uint32_t)));
+    gpuErrchk(cudaMalloc(&d_valor,   (datos + 1) * sizeof(float)));
+    gpuErrchk(cudaMemcpy(d_fila,    matriz.fila.data(),    matriz.fila.size() * sizeof(size_t), cudaMemcpyHostToDevice));
+    gpuErrchk(cudaMemcpy(d_columna, matriz.columna.data(), datos * sizeof(uint32_t),            cudaMemcpyHostToDevice));
+    gpuErrchk(cudaMemcpy(d_valor,   matriz.valor.data(),   datos * sizeof(float),               cudaMemcpyHostToDevice));
+
+    // tantos bloques por muestra como necesite la fila más larga
+    size_t maximo = 0;
+    for (size_t f = 0; f < matriz.filas(); f++)
+        if (maximo < matriz.fila[f + 1] - matriz.fila[f])
+            maximo = matriz.fila[f + 1] - matriz.fila[f];
+
+    if (maximo > 0)
+    {
+        dim3 bloques(uint((maximo + BLOCK_SIZE - 1) / BLOCK_SIZE), uint(matriz.filas()));
+        csr2full<<<bloques, BLOCK_SIZE>>>(cuda_data.d_haar, cuda_data.pitch, d_fila, d_columna, d_valor, matriz.origen);
+        gpuErrchk(cudaGetLastError());
+        gpuErrchk(cudaDeviceSynchronize());
+    }
 
+    cudaFree(d_fila);
+    cudaFree(d_columna);
+    cudaFree(d_valor);
 }
 
 
@@ -442,21 +621,15 @@ void cuda_send_data(datos_cuda &cuda_data)
   */
 void cuda_main(datos_cuda &cuda_data)
 {
-    // reserva TODA la memoria CONTIGUA para la matriz de muestras tranformadas -------------------
-    // para trasvase de datos entre GPU y CPU con CUDA, la matriz debe ser contigua completa
-    cuda_data.h_haar_C = new float*[cuda_data.samples];                             // reservar punteros a filas
-    cuda_data.h_haar_C[0] = new float[cuda_data.samples * (cuda_data.h_haar_L[0])];	// reservar toodos los datos (rows * cols)
-    for (int i = 1; i < cuda_data.samples; i++)                                     // asignar valor a punteros de fila
-        cuda_data.h_haar_C[i] = cuda_data.h_haar_C[i - 1] + cuda_data.h_haar_L[0];
+    // la matriz CONTIGUA de muestras tranformadas (cuda_data.h_haar_C) la reserva el motor de
+    // transformada con h_haar_L[0] datos por muestra
 
-
-    // reserva memoria para cálculos temporales en GPU --------------------------------------------
-    float *d_temp;
+    // memoria para cálculos temporales en GPU, del espacio de trabajo ---------------------------
     size_t pitch;
-    gpuErrchk(cudaMallocPitch(&d_temp,
-                              &pitch,
-                              (cuda_data.sample_num + 1) * sizeof(float) * 0.7,
-                              cuda_data.samples));
+    float *d_temp = temporal_gpu(cuda_data,
+                                 size_t((cuda_data.sample_num + 1) * sizeof(float) * 0.7),
+                                 cuda_data.samples,
+                                 pitch);
 
 
     // transforma el número de muestras elegida ---------------------------------------------------
@@ -503,9 +676,145 @@ void cuda_main(datos_cuda &cuda_data)
                           cuda_data.samples * sizeof(float),
                           cudaMemcpyDeviceToHost));
 
+}
+
+/** ***********************************************************************************************
+  * \fn void cuda_main_tiles(datos_cuda &)
+  *  \brief Función para procesar los datos en la GPU por teselas: la ventana se divide en tramos
+  *         de ancho_tesela columnas alineados a 2^niveles, cada tramo se rellena desde la matriz
+  *         dispersa residente, se transforma con wavedec y solo se guardan en h_haar_C sus
+  *         coeficientes del último nivel, por lo que la memoria de GPU no depende de la longitud
+  *         del cromosoma. La gráfica y el máximo se calculan después en CPU
+  *  \param &cuda_data  estructura con variables de control de datos
+  * ***********************************************************************************************
+  */
+void cuda_main_tiles(datos_cuda &cuda_data)
+{
+    const matriz_dispersa &matriz = *cuda_data.mc_csr;
+    size_t num = size_t(cuda_data.h_haar_L[0]);
+
+    // el tramo que resume cada coeficiente del último nivel no puede quedar partido entre teselas
+    int    aplicados = 0;
+    coeficientes_haar(cuda_data.sample_num, cuda_data.levels, aplicados);
+    size_t tramo = size_t(1) << aplicados;
+
+    if (tramo > cuda_data.ancho_tesela)
+    {
+        cudaFree(cuda_data.d_haar);
+        cudaFree(cuda_data.d_aux);
+        cuda_data.ancho_tesela = tramo;
+        gpuErrchk(cudaMallocPitch(&cuda_data.d_haar, &cuda_data.pitch,   (cuda_data.ancho_tesela + 2) * sizeof(float), cuda_data.samples));
+        gpuErrchk(cudaMallocPitch(&cuda_data.d_aux,  &cuda_data.pitch_2, (cuda_data.ancho_tesela + 2) * sizeof(float), cuda_data.samples));
+    }
+
+    size_t ancho       = cuda_data.ancho_tesela / tramo * tramo;
+    size_t por_tesela  = ancho / tramo;
+
+    // memoria temporal en GPU del espacio de trabajo: cálculos intermedios de wavedec, gráfica de
+    // la tesela (que no se usa) y límites de cada muestra dentro de la tesela
+    espacio_gpu &espacio = cuda_data.espacio;
+    size_t  pitch;
+    float  *d_temp  = temporal_gpu(cuda_data, size_t((ancho + 1) * sizeof(float) * 0.7), cuda_data.samples, pitch);
+    float  *d_plot  = vector_gpu(espacio, espacio.d_plot,  espacio.plot,  size_t(cuda_data.samples) * 4 * (por_tesela + 1));
+    size_t *d_rango = vector_gpu(espacio, espacio.d_rango, espacio.rango, size_t(cuda_data.samples) * 2);
+
+    vector<size_t> rango(size_t(cuda_data.samples) * 2);
+    vector<float>  tesela(size_t(cuda_data.samples) * (por_tesela + 1));
+
+    fill(cuda_data.h_haar_C[0], cuda_data.h_haar_C[0] + size_t(cuda_data.samples) * num, 0.0f);
+
+    for (size_t inicio = 0; inicio < cuda_data.sample_num; inicio += ancho)
+    {
+        size_t   datos    = min(ancho, cuda_data.sample_num - inicio);
+        uint32_t absoluto = uint32_t(matriz.origen + cuda_data.rango_inferior + inicio);
+
+        // datos de cada muestra dentro de la tesela
+        size_t maximo = 0;
+        for (size_t s = 0; s < size_t(cuda_data.samples); s++)
+        {
+            const uint32_t *primero = matriz.columna.data() + matriz.fila[s];
+            const uint32_t *ultimo  = matriz.columna.data() + matriz.fila[s + 1];
+            rango[2 * s]     = size_t(lower_bound(primero, ultimo, absoluto) - matriz.columna.data());
+            rango[2 * s + 1] = size_t(lower_bound(primero, ultimo, uint32_t(absoluto + datos)) - matriz.columna.data());
+            maximo = max(maximo, rango[2 * s + 1] - rango[2 * s]);
+        }
+        gpuErrchk(cudaMemcpy(d_rango, rango.data(), rango.size() * sizeof(size_t), cudaMemcpyHostToDevice));
+
+        // tesela a cero (también la auxiliar, para que el relleno de impares no arrastre datos)
+        gpuErrchk(cudaMemset2D(cuda_data.d_haar, cuda_data.pitch,   0, (ancho + 2) * sizeof(float), cuda_data.samples));
+        gpuErrchk(cudaMemset2D(cuda_data.d_aux,  cuda_data.pitch_2, 0, (ancho + 2) * sizeof(float), cuda_data.samples));
+
+        if (maximo > 0)
+        {
+            dim3 bloques(uint((maximo + BLOCK_SIZE - 1) / BLOCK_SIZE), uint(cuda_data.samples));
+            csr2tesela<<<bloques, BLOCK_SIZE>>>(cuda_data.d_haar, cuda_data.pitch, d_rango,
+                                                cuda_data.d_columna, cuda_data.d_valor, absoluto);
+            gpuErrchk(cudaGetLastError());
+        }
 
-    //libera la memoria temporal utilizada para cálculos intemedios
-    cudaFree(d_temp);
+        wavedec<<<1, cuda_data.samples>>>(cuda_data.d_haar,
+                                          cuda_data.d_aux,
+                                          d_temp,
+                                          cuda_data.pitch,
+                                          cuda_data.pitch_2,
+                                          pitch,
+                                          int(datos),
+                                          cuda_data.levels,
+                                          cuda_data.samples,
+                                          0,
+                                          d_plot);
+        gpuErrchk(cudaDeviceSynchronize());
+
+        // la última tesela puede ser más corta que el tramo y quedarse en menos niveles: se escala
+        // como si se hubiese seguido rellenando con ceros hasta el nivel de la ventana completa
+        int    niveles_tesela = 0;
+        size_t coeficientes   = coeficientes_haar(datos, cuda_data.levels, niveles_tesela);
+        float  escala         = float(pow(sqrt(0.5), aplicados - niveles_tesela));
+
+        gpuErrchk(cudaMemcpy2D(tesela.data(),
+                               coeficientes * sizeof(float),
+                               cuda_data.d_aux,
+                               cuda_data.pitch_2,
+                               coeficientes * sizeof(float),
+                               cuda_data.samples,
+                               cudaMemcpyDeviceToHost));
+
+        size_t desde = inicio / tramo;
+        for (size_t s = 0; s < size_t(cuda_data.samples); s++)
+            for (size_t j = 0; j < coeficientes && desde + j < num; j++)
+                cuda_data.h_haar_C[s][desde + j] = tesela[s * coeficientes + j] * escala;
+    }
+}
+
+/** ***********************************************************************************************
+  * \fn int cuda_dispositivos()
+  *  \brief Función para contar las gpus con soporte CUDA
+  *  \return    número de dispositivos (0 si no hay controlador o dispositivo)
+  * ***********************************************************************************************
+  */
+int cuda_dispositivos()
+{
+    int deviceCount = 0;
+    if (cudaGetDeviceCount(&deviceCount) != cudaSuccess)
+        return 0;
+
+    return deviceCount;
+}
+
+/** ***********************************************************************************************
+  * \fn int cuda_memoria()
+  *  \brief Función para consultar la memoria total de la gpu
+  *  \return    memoria en MiB
+  * ***********************************************************************************************
+  */
+int cuda_memoria()
+{
+    size_t libre = 0;
+    size_t total = 0;
+    if (cudaMemGetInfo(&libre, &total) != cudaSuccess)
+        return 0;
+
+    return int(total / (1024 * 1024));
 }
 
 /** ***********************************************************************************************
@@ -546,6 +855,13 @@ void cuda_end(datos_cuda &cuda_data)
     //libera la memoria de la gpu utilizada para cálculos intemedios
     cudaFree(cuda_data.d_haar);
     cudaFree(cuda_data.d_aux);
+    cudaFree(cuda_data.d_columna);
+    cudaFree(cuda_data.d_valor);
+    libera_espacio(cuda_data.espacio);
+    cuda_data.d_haar    = nullptr;
+    cuda_data.d_aux     = nullptr;
+    cuda_data.d_columna = nullptr;
+    cuda_data.d_valor   = nullptr;
 }
 
 /** ***********************************************************************************************
@@ -614,30 +930,3 @@ void cuda_unmap(void *res)
     if (cudaGraphicsUnmapResources(1,(cudaGraphicsResource **) &res, 0) != cudaSuccess)
         puts("Fallo en el desmapeado de recursos");
 }
-
-/** ***********************************************************************************************
-  * \fn void calculo_haar_L(datos_cuda &cuda_data)
-  *  \brief Función para calcular el número de datos en el nivel dado y el ajuste por impares
-  *  \param &cuda_data  estructura con variables de control de datos
-  * ***********************************************************************************************
-  */
-void cuda_calculo_haar_L(datos_cuda &cuda_data)
-{
-    // cálculo de número de coeficientes por nivel y del ajuste de paso entre escala y coeficiente
-    cuda_data.h_haar_L.push_front(cuda_data.sample_num);	// última posición guarda el total de posiciones por muestra
-
-    // para cada nivel se divide por dos la cantidad de posiciones del nivel anterior -------------
-    // redondeando al alza y actualizando el ajuste cuando sea impar
-    for (int fila = cuda_data.levels; fila > 0; fila--)
-    {
-        if (ceil(cuda_data.h_haar_L.front() * 0.5 >= 2))
-        {
-            cuda_data.h_haar_L.push_front(ceil(cuda_data.h_haar_L.front() * 0.5));
-            if (fila > 0 && cuda_data.h_haar_L[1] != cuda_data.sample_num)
-                cuda_data.data_adjust += size_t(2 * cuda_data.h_haar_L.front() - cuda_data.h_haar_L[1]);
-        }
-        else
-            break;
-    }
-    cuda_data.h_haar_L.push_front(cuda_data.h_haar_L.front());	// primera posición coincide con el número de datos de escala
-}
@@ -1,5 +1,7 @@
 #include "hpg_dhunter.h"
 #include "ui_hpg_dhunter.h"
+#include "paralelo.h"
+#include "dmr_stats.h"
 #include <QFileDialog>
 #include <QDebug>
 #include <QFile>
@@ -27,12 +29,16 @@ HPG_Dhunter::HPG_Dhunter(QWidget *parent) :
     limite_superior          = 1000;
     cuda_data.rango_inferior = size_t(ui->scroll_adn->value());
     cuda_data.rango_superior = size_t(ui->scroll_adn->value() + ui->scroll_adn->pageStep());
-    cuda_data.mc_full        = nullptr;
+    cuda_data.mc_csr         = nullptr;
     cuda_data.h_haar_C       = nullptr;
     cuda_data.d_aux          = nullptr;
     cuda_data.d_haar         = nullptr;
     cuda_data.refGen         = nullptr;
     cuda_data.d_glPtr        = nullptr;
+    cuda_data.d_columna      = nullptr;
+    cuda_data.d_valor        = nullptr;
+    cuda_data.ancho_tesela   = 0;
+    cuda_data.espacio        = espacio_gpu();
     cuda_data.d_max          = new float[2];
     dmr_diff                 = nullptr;
     page_pressed             = true;
@@ -66,26 +72,16 @@ HPG_Dhunter::HPG_Dhunter(QWidget *parent) :
     primera_seleccion_control = true;
 
 
-    // comprueba la memoria disponible en la tarjeta gráfica para controlar los ficheros a cargar
-    // ..captura la información suministrada por el comando "nvidia-smi"
-    QProcess p;
-    p.start("nvidia-smi");
-    p.waitForFinished();
-    QString data = p.readAllStandardOutput();
-    p.close();
-
-    // ..busca los datos que concuerdan con "[[:digit:]]+MiB" y se queda con el segundo dato
-    //   que informa de la capacidad total de memoria de la tarjeta
-    QRegularExpression re("(\\d+)MiB");
-    QRegularExpressionMatchIterator i = re.globalMatch(data);
-    i.next();
-    QRegularExpressionMatch match = i.next();
-    qDebug() << match.captured(0) << match.captured(1);
+    // motor de transformada: inicializa su dispositivo al crearse el contexto de OpenGL y limita
+    // (si tiene límite) la cantidad de datos que se pueden analizar a la vez
+    motor = crea_motor();
+    ui->ventana_opengl->setMotor(motor);
+    memory_available = motor->memoria_disponible();
 
-    // ..se asigna a la variable el valor en MiB
-    memory_available = match.captured(1).toInt();
-
-    ui->statusBar->showMessage("System available GPU RAM: " + QString::number(memory_available));
+    if (memory_available > 0)
+        ui->statusBar->showMessage("Transform engine: " + motor->nombre() + " - available RAM: " + QString::number(memory_available) + " MiB");
+    else
+        ui->statusBar->showMessage("Transform engine: " + motor->nombre());
 
 
     // mantiene el último path en el explorador de ficheros
@@ -101,10 +97,9 @@ HPG_Dhunter::HPG_Dhunter(QWidget *parent) :
 HPG_Dhunter::~HPG_Dhunter()
 {
     ui->ventana_opengl->unregisterBuffer();
-    cuda_end(cuda_data);
-    delete [] cuda_data.mc_full[0];
-    delete [] cuda_data.mc_full;
+    motor->libera(cuda_data);
     delete ui;
+    delete motor;
 }
 
 // ************************************************************************************************
@@ -964,6 +959,11 @@ void HPG_Dhunter::on_threshold_valueChanged(int value)
 {
     threshold = float(value * 0.01);
     ui->threshold_label->setText(QString::number(double(threshold), 'f', 2));
+
+    // número de DMRs con el nuevo umbral mientras se mueve el control
+    if (!indice_dmr.tramos.empty())
+        ui->statusBar->showMessage(QString::number(indice_dmr.dmrs(threshold)) + " DMRs at threshold " +
+                                   QString::number(double(threshold), 'f', 2));
 }
 
 // ************************************************************************************************
@@ -1022,6 +1022,8 @@ void HPG_Dhunter::on_mC_clicked()
 
     _mc  = ui->mC->isChecked();
     _hmc = ui->hmC->isChecked();
+
+    avisa_filtro_carga();
 }
 
 // ************************************************************************************************
@@ -1032,6 +1034,19 @@ void HPG_Dhunter::on_hmC_clicked()
 
     _mc  = ui->mC->isChecked();
     _hmc = ui->hmC->isChecked();
+
+    avisa_filtro_carga();
+}
+
+// ************************************************************************************************
+void HPG_Dhunter::avisa_filtro_carga()
+{
+    // las posiciones cargadas con filtro se seleccionaron por la cobertura del otro tipo de análisis
+    if (parametros.size() > 7 && parametros[5].toInt() && parametros[7].toInt() != int(_hmc))
+        ui->statusBar->showMessage("files were filtered on load by " +
+                                   QString(parametros[7].toInt() ? "5hmC" : "5mC") +
+                                   " coverage, load them again to analyze " +
+                                   QString(_hmc ? "5hmC" : "5mC"));
 }
 
 // ************************************************************************************************
@@ -1063,6 +1078,18 @@ void HPG_Dhunter::on_forward_clicked()
     ui->load_files->setEnabled(true);
 }
 
+// ************************************************************************************************
+void HPG_Dhunter::on_filtra_carga_clicked()
+{
+    ui->load_files->setEnabled(true);
+}
+
+// ************************************************************************************************
+void HPG_Dhunter::on_comprime_memoria_clicked()
+{
+    ui->load_files->setEnabled(true);
+}
+
 // ************************************************************************************************
 void HPG_Dhunter::on_reverse_clicked()
 {
@@ -1098,35 +1125,17 @@ void HPG_Dhunter::mouse_coordinates_ogl(int x)
 
     for (uint i = 0; i < mc.size(); i++)
     {
-        // ..búsqueda binaria sobre el fichero de cobertura de la posición
-        uint inicio = 0;
-        uint fin    = uint(mc[i].size());
-        uint mitad  = 0;
-        bool match  = false;
-
-        while (inicio < fin && !match)
-        {
-            mitad  = uint((inicio + fin) * 0.5);
-
-            if (uint(mc[i][mitad][0]) == posicion)
-                break;
-            else
-            {
-                if (uint(mc[i][mitad][0]) < posicion)
-                    inicio = mitad + 1;
-                else
-                    fin = mitad - 1;
-            }
-        }
+        // primer sitio de la muestra en la posición del puntero o después
+        size_t sitio = mc[i].busca(posicion);
 
         // una vez posicionado, se busca el valor máximo de cobertura en la franja de posiciones
         // del genoma visualizado que comprende el puntero en cada posición de la ventana
         posicion += factor_escala;
-        while (posicion > mc[i][mitad][0])
+        while (sitio < mc[i].size() && posicion > mc[i].posicion(sitio))
         {
-            if (cobertura_maxima < mc[i][mitad][2])
-                cobertura_maxima = int(mc[i][mitad][2]);
-            mitad++;
+            if (cobertura_maxima < mc[i].cobertura_mC(sitio))
+                cobertura_maxima = int(mc[i].cobertura_mC(sitio));
+            sitio++;
         }
 
         linea.append(" s" + QString::number(i+1) + " " + QString::number(cobertura_maxima));
@@ -1218,8 +1227,8 @@ void HPG_Dhunter::mouse_coordinates_ogl(int x, int y, int xR, int yR)
 // ************************************************************************************************
 void HPG_Dhunter::on_load_files_clicked()
 {
-    // libera memoria GPU
-    cuda_end(cuda_data);
+    // libera los datos del motor de transformada
+    motor->libera(cuda_data);
 
     // inhabilita botón de análisis mientras carga muestras
     ui->analiza->setEnabled(false);
@@ -1235,9 +1244,20 @@ void HPG_Dhunter::on_load_files_clicked()
     parametros = (QStringList() << QString::number(_forward) <<    // se informa forward reads 0/1
                                    QString::number(_reverse) <<    // se informa reverse reads 0/1
                                    "0" <<                          // se informa del número de cromosoma
-                                   "0"                             // se informa del número de hilo asignado
+                                   "0" <<                          // se informa del número de hilo asignado
+                                   "1" <<                          // se informa de los hilos de análisis por fichero
+                                   QString::number(ui->filtra_carga->isChecked()) <<   // se informa del filtrado por cobertura en lectura 0/1
+                                   QString::number(ui->cobertura->value()) <<          // se informa de la cobertura mínima
+                                   QString::number(ui->hmC->isChecked()) <<            // se informa de la cobertura sobre mC/hmC 0/1
+                                   "0" <<                          // se informa de la primera posición de la región a leer
+                                   "0" <<                          // se informa de la última posición de la región a leer
+                                   QString::number(ui->comprime_memoria->isChecked())  // se informa de la compresión en memoria 0/1
                  );
 
+    // con filtrado en lectura no quedan posiciones por debajo de la cobertura de carga,
+    // por lo que el umbral de cobertura no puede bajar de ese valor hasta la siguiente carga
+    ui->cobertura->setMinimum(ui->filtra_carga->isChecked() ? ui->cobertura->value() : 1);
+
     ficheros_case    = ui->wavelet_file->toPlainText().split("\n");
     ficheros_control = ui->control_file->toPlainText().split("\n");
     contador         = 0;
@@ -1274,9 +1294,9 @@ void HPG_Dhunter::on_load_files_clicked()
         foreach(auto n, ficheros_case)
         {
             QFile archivo;
-            QString file = n + "/methylation_map_" +
-                           (_forward? (_reverse? "mix_" : "forward_") : "reverse_") +
-                           QString::number(cromosoma) + ".csv";
+            QString file = ruta_mapa(n + "/methylation_map_" +
+                                     (_forward? (_reverse? "mix_" : "forward_") : "reverse_") +
+                                     QString::number(cromosoma));
 
             archivo.setFileName(file);
             if (!archivo.open(QIODevice::ReadOnly))
@@ -1296,9 +1316,9 @@ void HPG_Dhunter::on_load_files_clicked()
             foreach(auto n, ficheros_control)
             {
                 QFile archivo;
-                QString file = n + "/methylation_map_" +
-                               (_forward? (_reverse? "mix_" : "forward_") : "reverse_") +
-                               QString::number(cromosoma) + ".csv";
+                QString file = ruta_mapa(n + "/methylation_map_" +
+                                         (_forward? (_reverse? "mix_" : "forward_") : "reverse_") +
+                                         QString::number(cromosoma));
 
                 archivo.setFileName(file);
                 if (!archivo.open(QIODevice::ReadOnly))
@@ -1350,7 +1370,7 @@ void HPG_Dhunter::on_load_files_clicked()
 
             // limpia la matrix de datos del cromosoma anterior
             ui->statusBar->showMessage("freeing memory");
-            vector<vector<vector<double>>>().swap(mc);
+            vector<muestra_metilacion>().swap(mc);
 
             limite_inferior = 100000000;        // control de límite inferior
             limite_superior = 0;                // control de límite superior
@@ -1366,18 +1386,45 @@ void HPG_Dhunter::on_load_files_clicked()
 
             ui->statusBar->showMessage("loading files...");
 
+            // cola de ficheros pendientes de leer, en el orden de las listas de casos y controles
+            int num_ficheros = ficheros_case.size() + ficheros_control.size();
+            cola_lectura.clear();
+            for (int i = 0; i < num_ficheros; i++)
+                cola_lectura.enqueue(i);
+            progreso_ficheros.assign(uint(num_ficheros), 0);
+
+            // un hueco por muestra en la matriz de datos, en el orden de las listas: primero los
+            // casos y después los controles; cada lector deja en su hueco la muestra que lee
+            mc.resize(uint(num_ficheros));
+
+            // número de lectores limitado por los núcleos disponibles y por la capacidad del disco
+            // para atender lecturas simultáneas; cada lector toma ficheros de la cola hasta vaciarla
+            int lectores = QThread::idealThreadCount();
+            if (lectores > LECTORES_DISCO)
+                lectores = LECTORES_DISCO;
+            if (lectores > num_ficheros)
+                lectores = num_ficheros;
+            if (lectores < 1)
+                lectores = 1;
+
             // crea nuevos hilos para lectura de ficheros
-            for (int i = 0; i < ficheros_case.size() + ficheros_control.size(); i++)
+            for (int i = 0; i < lectores; i++)
             {
                 hilo_files_worker.append(new QThread());
                 files_worker.append(new Files_worker());
             }
 
+            // reparte los núcleos disponibles entre los lectores para analizar cada fichero por bloques
+            // con pocas muestras, cada fichero se analiza con varios hilos
+            int hilos_por_fichero = QThread::idealThreadCount() / lectores;
+            parametros[4] = QString::number(hilos_por_fichero > 1 ? hilos_por_fichero : 1);
+
             // moviendo workers a los hilos y conexiones para el proceso de lectura de ficheros
             for (int i = 0; i < hilo_files_worker.size(); i++)
             {
                 files_worker[i]->moveToThread(hilo_files_worker[i]);
                 connect(files_worker[i], SIGNAL(fichero_leido(int, int, int, int)), SLOT(fichero_leido(int, int, int, int)));
+                connect(files_worker[i], SIGNAL(progreso_lectura(int, int)), SLOT(progreso_lectura(int, int)));
                 connect(hilo_files_worker[i], &QThread::finished, files_worker[i], &QObject::deleteLater);
                 files_worker[i]->connect(hilo_files_worker[i], SIGNAL(started()), SLOT(lectura()));
                 hilo_files_worker[i]->connect(files_worker[i],SIGNAL(lectura_solicitada()), SLOT(start()));
@@ -1392,8 +1439,12 @@ void HPG_Dhunter::on_load_files_clicked()
                 parametros[3] = QString::number(i);
                 qDebug() << "cromosoma a leer:" << parametros[2] << parametros[3];
 
-                // se lanza el hilo de lectura de ficheros para el cromosoma seleccionado
-                files_worker[i]->solicitud_lectura(ficheros_case, ficheros_control, parametros, mc_aux, mutex);
+                // se lanza el hilo de lectura de ficheros para el cromosoma seleccionado, completo o
+                // solo la región [start, end] indicada
+                files_worker[i]->solicitud_region(ficheros_case, ficheros_control, parametros,
+                                                  ui->carga_inicio->text().toUInt(),
+                                                  ui->carga_final->text().toUInt(),
+                                                  mc, cola_lectura, mutex);
             }
 
             // se lanza el hilo de carga de referencias genéticas, si se dispone de ellas
@@ -1430,8 +1481,8 @@ void HPG_Dhunter::on_analiza_clicked()
     ui->analiza->setEnabled(false);
     ui->load_files->setEnabled(false);
 
-    // comprueba la dimensión de la matriz mc para ver si caben todos los datos en GPU
-    // en caso contrario, avisa al usuario para que seleccione un conjunto de muestras adecuado.
+    // dimensión de la matriz mc: si no cabe completa en la memoria del motor, éste la procesa por
+    // teselas de tamaño fijo en lugar de limitar las muestras a analizar
     uint dimension = limite_superior - limite_inferior + 1;
     if ((dimension & 0x01) == 1)
         dimension++;
@@ -1439,18 +1490,6 @@ void HPG_Dhunter::on_analiza_clicked()
     int casos = int(count(visualiza_casos.begin(), visualiza_casos.end(), true));
     int control = int(count(visualiza_control.begin(), visualiza_control.end(), true));
     int samples2visualize = casos + control;
-    uint tamanyo = (dimension * sizeof(float) * uint(samples2visualize)) / (1024 * 1024); // tamaño en MiB
-
-    if (tamanyo > 0.25 * memory_available)
-    {
-        QMessageBox::warning(this,
-                             "ERROR: too much samples to visualize",
-                             "The GPU memory available will overloaded\n"
-                             "Please, select a minor number of samples\n"
-                             "to visualize"
-                            );
-        return;
-    }
 
     qDebug() << "numero de samples a visualizar:" << samples2visualize;
 
@@ -1473,78 +1512,45 @@ void HPG_Dhunter::on_analiza_clicked()
     QTimer::singleShot(100, &loop, SLOT(quit()));
     loop.exec();
 
-    // borra la memoria previa utilizada
-    if (cuda_data.mc_full != nullptr)
-    {
-        delete [] cuda_data.mc_full[0];
-        delete [] cuda_data.mc_full;
-    }
-
-    if (cuda_data.h_haar_C != nullptr)
-    {
-        delete [] cuda_data.h_haar_C[0];
-        delete [] cuda_data.h_haar_C;
-    }
-
-    // crea matriz ampliada -------------------------------------------------------------------
-    //      -> vectores con todas las posiciones contiguas
-    //      -> con ceros en las posiciones sin metilación
-    // reserva TODA la memoria CONTIGUA con todos los datos de todas las muestras
-    // para trasvase de datos entre GPU y CPU con CUDA, la matriz debe ser contigua completa
-    // reserva la memoria para la matriz de datos extendida
-    cuda_data.mc_full = new float*[cuda_data.samples];
-    cuda_data.mc_full[0] = new float[uint(cuda_data.samples) * cuda_data.sample_num](); //paréntesis finales llamar constructor para rellenar con ceros
-    for (int i = 1; i < cuda_data.samples; i++)
-            cuda_data.mc_full[i] = cuda_data.mc_full[i - 1] + cuda_data.sample_num;
-
-    vector<vector<uint>>(uint(mc.size()), vector<uint>()).swap(posicion_metilada);
-
-    // copia de todos los datos a la matriz ampliada
+    // copia de todos los datos a la matriz de muestras
     // --------------------------------------------------------------------------------------------
-    uint muestra_seleccionada = 0;
-
+    // selecciona las muestras a visualizar en el orden de mc: casos y después controles
+    vector<const muestra_metilacion *> seleccion;
+    h_haar_C_distribucion.clear();
     for (uint m = 0; m < mc.size(); m++)
     {
         // comprueba si la posición m corresponde a caso o control
-        if (uint(mc[m][0][11]) == 0)
+        if (mc[m].grupo == 0)
         {
             // comprueba si la posición está seleccionada para visualizar
-            if (visualiza_casos[uint(mc[m][0][10])])
+            if (visualiza_casos[uint(mc[m].muestra)])
             {
-                // rellena con datos las posiciones metiladas si supera la cobertura
-                for (uint k = 0; k < mc[m].size(); k++)
-                    if(mc[m][k][ui->mC->isChecked() ? 2 : 8] >= ui->cobertura->value())
-                    {
-                        cuda_data.mc_full [muestra_seleccionada][uint(mc[m][k][0]) - limite_inferior] = float(mc[m][k][ui->mC->isChecked() ? 1 : 7]);
-
-                        posicion_metilada[muestra_seleccionada].push_back(uint(mc[m][k][0] - limite_inferior));
-                    }
-
+                seleccion.push_back(&mc[m]);
                 h_haar_C_distribucion.push_back(0);
-                muestra_seleccionada++;
             }
         }
         else
         {
             // comprueba si la posición está seleccionada para visualizar
-            if (visualiza_control[uint(mc[m][0][10])])
+            if (visualiza_control[uint(mc[m].muestra)])
             {
-                // rellena con datos las posiciones metiladas si supera la cobertura
-                for (uint k = 0; k < mc[m].size(); k++)
-                    if(mc[m][k][ui->mC->isChecked() ? 2 : 8] >= ui->cobertura->value())
-                    {
-                        cuda_data.mc_full [muestra_seleccionada][uint(mc[m][k][0]) - limite_inferior] = float(mc[m][k][ui->mC->isChecked() ? 1 : 7]);
-
-                        posicion_metilada[muestra_seleccionada].push_back(uint(mc[m][k][0] - limite_inferior));
-                    }
-
+                seleccion.push_back(&mc[m]);
                 h_haar_C_distribucion.push_back(1);
-                muestra_seleccionada++;
             }
         }
     }
 
-    qDebug() << "matriz de datos totalmente llena" << muestra_seleccionada;
+    // diccionario de posiciones metiladas que superan la cobertura en alguna muestra seleccionada
+    // y matriz dispersa con sus valores: una fila por muestra
+    cohorte.construye(seleccion, !ui->mC->isChecked(), ui->cobertura->value(), hilos_disponibles());
+    cohorte.matriz.origen = limite_inferior;
+
+    qDebug() << "diccionario de posiciones: " << cohorte.posiciones.size() << " - " << cohorte.bytes() << " bytes";
+
+    // la matriz dispersa se envía tal cual al motor de transformada
+    cuda_data.mc_csr = &cohorte.matriz;
+
+    qDebug() << "matriz de datos totalmente llena" << seleccion.size();
 
     // actualización de límites, rangos de sliders y demás datos de interfaz
     // --------------------------------------------------------------------------------------------
@@ -1572,23 +1578,18 @@ void HPG_Dhunter::on_analiza_clicked()
     ui->slider_nivel->setMaximum(int(log2(ui->scroll_adn->pageStep())));
     ui->slider_nivel->setValue(ui->slider_nivel->maximum() - 3);
 
-    // envía los datos a la memoria global de la GPU
+    // envía los datos al motor de transformada
     // --------------------------------------------------------------------------------------------
-    // informa de proceso de copia de datos a memoria GPU
-    ui->statusBar->showMessage("loading full segments to GPU memory...");
+    // informa de proceso de copia de datos
+    ui->statusBar->showMessage("loading full segments to " + motor->nombre() + "...");
 
-    // libera la memoria de la GPU
-    cuda_end(cuda_data);
+    // libera los datos previos y prepara los nuevos (pirámide en CPU o matriz completa en GPU)
+    motor->envia(cuda_data);
 
-    qDebug() << "memoria GPU liberada";
-
-    // envía el total de los datos a la GPU
-    cuda_send_data(cuda_data);
-
-    qDebug() << "datos cargados en GPU";
+    qDebug() << "datos cargados en" << motor->nombre();
 
     // informa de proceso de lectura de datos finalizado
-    ui->statusBar->showMessage("samples loaded, ready to transform -> data in GPU global memory");
+    ui->statusBar->showMessage("samples loaded, ready to transform -> " + motor->nombre());
 
     // habilita detección de DMRs
     ui->dmrs->setEnabled(true);
@@ -1648,7 +1649,7 @@ void HPG_Dhunter::dibuja()
     cuda_data.d_max[0] = 1.0;
 
     // tranforma la ventana de datos correspondiente ------------------------------------------
-    cuda_calculo_haar_L(cuda_data);
+    calculo_haar_L(cuda_data);
 
     ui->ventana_opengl->setNum_L(cuda_data.h_haar_L[0]);
     ui->ventana_opengl->setNum_samples(cuda_data.samples, int(count(visualiza_casos.begin(), visualiza_casos.end(), true)));
@@ -1656,10 +1657,14 @@ void HPG_Dhunter::dibuja()
     ui->ventana_opengl->registerBuffer();
     ui->ventana_opengl->mapResource(cuda_data);
 
-    cuda_main(cuda_data);
+    motor->transforma(cuda_data);
 
     ui->ventana_opengl->unmapResource();
 
+    // vértices calculados en CPU si el motor no dibuja directamente en el buffer
+    if (!cuda_data.h_plot.empty())
+        ui->ventana_opengl->cargaVertices(cuda_data.h_plot);
+
     // plotea la señal transformada -----------------------------------------------------------
     ui->ventana_opengl->update();   // con QOpenGLWidget
 
@@ -1675,6 +1680,16 @@ void HPG_Dhunter::dibuja()
 
     STOP_TIMER("tiempo dibujado")
 
+#ifdef TIMING
+    // espacio de trabajo de la transformada: tras la primera ventana solo debe reutilizarse
+    qDebug() << "espacio CPU: reservas" << motor->contadores().reservas
+             << "reutilizaciones" << motor->contadores().reutilizaciones
+             << "máximo" << motor->contadores().bytes << "bytes";
+    qDebug() << "espacio GPU: reservas" << cuda_data.espacio.contadores.reservas
+             << "reutilizaciones" << cuda_data.espacio.contadores.reutilizaciones
+             << "máximo" << cuda_data.espacio.contadores.bytes << "bytes";
+#endif
+
     // informa de proceso en barra inferior ---------------------------------------------------
     ui->statusBar->showMessage("transform finished -> data in GPU and CPU memory. Plotted");
 
@@ -1701,7 +1716,7 @@ void HPG_Dhunter::on_dmrs_clicked()
     START_TIMER
 
     // limpia matriz de resultados de procesamiento en GPU
-    vector<vector<float>>().swap(h_haar_C);
+    h_haar_C.clear();
 
     // actualiza datos
     cuda_data.h_haar_L.clear();                                         // vector con número de datos por nivel
@@ -1712,26 +1727,22 @@ void HPG_Dhunter::on_dmrs_clicked()
     cuda_data.data_adjust    = 0;                                       // ajuste desfase en división por nivel para número impar de datos
 
     // tranforma la ventana de datos correspondiente ------------------------------------------
-    cuda_calculo_haar_L(cuda_data);
+    calculo_haar_L(cuda_data);
 
-    ui->ventana_opengl->setNum_L(cuda_data.h_haar_L[0]);
-    ui->ventana_opengl->registerBuffer();
-    ui->ventana_opengl->mapResource(cuda_data);
-
-    cuda_main(cuda_data);
-
-    ui->ventana_opengl->unmapResource();
-
-    // recoge los resultados en una matriz, acumulando todos los resultados
-    vector<float> aux(ulong(cuda_data.h_haar_L[0]), 0.0);
-    for (int i = 0; i < cuda_data.samples; i++)
+    // coeficientes del cromosoma completo en el nivel de detección, h_haar_L[0] por muestra; el
+    // motor en GPU transforma sobre el buffer de dibujo, por lo que necesita tenerlo mapeado
+    if (motor->comparte_buffer())
     {
-        for (size_t j = 0; j < size_t(cuda_data.h_haar_L[0]); j++)
-            aux[j] = cuda_data.h_haar_C[i][j];
-
-        h_haar_C.push_back(aux);
+        ui->ventana_opengl->setNum_L(cuda_data.h_haar_L[0]);
+        ui->ventana_opengl->registerBuffer();
+        ui->ventana_opengl->mapResource(cuda_data);
     }
 
+    motor->coeficientes_bloques(cuda_data, h_haar_C, hilos_disponibles());
+
+    if (motor->comparte_buffer())
+        ui->ventana_opengl->unmapResource();
+
     // restituye la estructura de variables para el segmento analizado ------------------------
     cuda_data.rango_inferior = uint(ui->scroll_adn->value()) - limite_inferior;
     cuda_data.rango_superior = uint(ui->scroll_adn->value()) - limite_inferior + uint(ui->scroll_adn->pageStep());
@@ -1742,60 +1753,48 @@ void HPG_Dhunter::on_dmrs_clicked()
         delete[] dmr_diff;
 
     dmr_diff = new float[cuda_data.h_haar_L[0]];
-    for (int i = 0; i < cuda_data.h_haar_L[0]; i++)
-        dmr_diff[i] = 0.0;
 
     uint paso = uint(pow(2, ui->dmr_dwt_level->value()));
 
-    vector<uint> idx_pos_met (uint(mc.size()), 0);
-
-    // realiza el cálculo de medias de las muestras de control de los casos
-    for (uint m = 0; m < uint(cuda_data.h_haar_L[0]); m++) // ...en cada posición
-    {
-        float media_casos   = 0.0;
-        float media_control = 0.0;
-        uint numero_casos   = 0;
-        uint numero_control = 0;
-        for (uint i = 0; i < uint(cuda_data.samples); i++)
-        {
-            uint aux_1 = 0;
-            uint aux_2 = 0;
+    // número mínimo de posiciones metiladas de una muestra en la región para tenerla en cuenta
+    // (entero por exceso: el número de sitios lo alcanza si y solo si alcanza el valor exacto)
+    double minimo_sitios = paso * uint(ui->num_CpG_x_region->value()) * 0.01;
 
-            while (m * paso >= posicion_metilada[i][idx_pos_met[i] + aux_1] && idx_pos_met[i] + aux_1 < posicion_metilada[i].size() - 1)
-                aux_1++;
+    criterio_dmr criterio;
+    criterio.origen         = limite_inferior;
+    criterio.paso           = paso;
+    criterio.minimo_sitios  = uint32_t(ceil(minimo_sitios));
+    criterio.minimo_casos   = uint(ficheros_case.length()    * (ui->min_covSamples_x_region->value() * 0.01));     // al menos el XX% por grupo tienen cobertura
+    criterio.minimo_control = uint(ficheros_control.length() * (ui->min_covSamples_x_region->value() * 0.01));
 
-            aux_2 = aux_1;
+    // grupo de cada fila de la cohorte: las filas son solo las muestras seleccionadas, no todas las de mc
+    vector<int> grupo(h_haar_C_distribucion.begin(), h_haar_C_distribucion.end());
 
-            while ((m + 1) * paso > posicion_metilada[i][idx_pos_met[i] + aux_2] && idx_pos_met[i] + aux_2 < posicion_metilada[i].size() - 1)
-                aux_2++;
-
-            idx_pos_met[i] += aux_2;
+    // realiza el cálculo de medias de las muestras de control y de los casos en cada región,
+    // repartiendo las regiones entre los hilos
+    {
+        INIT_TIMER
+        diferencia_grupos(h_haar_C, cohorte, grupo, criterio, dmr_diff, &dmr_estadistica, hilos_disponibles());
+        STOP_TIMER_MBS("diferencia de grupos por bloques", h_haar_C.bytes())
+    }
 
-            if (aux_2 - aux_1 >= paso * uint(ui->num_CpG_x_region->value()) * 0.01)
-            {
-                if (int(mc[i][0][11]) == 0)
-                {
-                    media_control += h_haar_C[i][m];
-                    numero_control++;
-                }
-                else
-                {
-                    media_casos += h_haar_C[i][m];
-                    numero_casos++;
-                }
-            }
-        }
+#if defined(TIMING) && defined(BENCHMARK_DMR)
+    // referencia: la misma diferencia sobre los coeficientes en una fila por muestra
+    {
+        vector<vector<float>> filas = h_haar_C.filas();
+        vector<float>         referencia(size_t(cuda_data.h_haar_L[0]));
 
-        if (numero_casos   >= (uint(ficheros_case.length()    * (ui->min_covSamples_x_region->value() * 0.01))) &&
-            numero_control >= (uint(ficheros_control.length() * (ui->min_covSamples_x_region->value() * 0.01))))          // al menos el XX% por grupo tienen cobertura
-        {
-            dmr_diff[m] = (media_casos / numero_casos) - (media_control / numero_control);
-        }
+        INIT_TIMER
+        diferencia_grupos(filas, cohorte, grupo, criterio, referencia.size(), referencia.data(), hilos_disponibles());
+        STOP_TIMER_MBS("diferencia de grupos por muestras", h_haar_C.bytes())
     }
-
+#endif
 
     dmr_diff_cols = uint(cuda_data.h_haar_L[0]);
 
+    // índice por |diferencia| para contar y hallar las DMRs de cualquier umbral sin recorrer dmr_diff
+    indice_dmr.construye(dmr_diff, dmr_diff_cols);
+
     // llama a función de cálculo de diferencias entre muestras para ponerlas en la tabla
     hallar_dmrs();
 
@@ -1807,20 +1806,14 @@ void HPG_Dhunter::hallar_dmrs()
 {
     QString linea      = "";
     uint paso          = uint(pow(2, ui->dmr_dwt_level->value()));
-    uint *posicion_dmr = new uint[dmr_diff_cols];    // crear array de posición
 
     // informa de proceso en barra inferior ---------------------------------------------------
     ui->statusBar->showMessage("Looking for DMRs");
 
     // encontrar DMRs en función del threshold establecido ------------------------------------
-    // llenar de 0s el vector de posicion de DMRs
-    for (uint p = 0; p < dmr_diff_cols; p++)
-        posicion_dmr[p] = 0;
-
-    // rellenar las posiciones con diferencias válidas
-    for (uint j = 0; j < dmr_diff_cols; j++)
-        if (dmr_diff[j] > threshold || dmr_diff[j] < -threshold)
-            posicion_dmr[j] = j * paso + limite_inferior;
+    // regiones con diferencias válidas en orden de posición, tomadas del índice por |diferencia|
+    vector<uint32_t> regiones;
+    indice_dmr.regiones(threshold, regiones);
 
     // rellenar ventana de datos - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
     dmr_listo = false;
@@ -1830,126 +1823,129 @@ void HPG_Dhunter::hallar_dmrs()
     // busca y rellena la lista de DMRs
     int inicio = 0;
     int fin    = int(num_genes);
-    for (uint p = 0; p < dmr_diff_cols; p++)
+    for (size_t r = 0; r < regiones.size(); r++)
     {
-        if (posicion_dmr[p] >= limite_inferior)
+        linea.clear();
+        uint q = regiones[r];       // para ayuda en la zona de detección de referencia de genoma
+
+        // busca las regiones inicial y final de la DMR
+        //-----------------------------------------------
+        while (r + 1 < regiones.size() && regiones[r + 1] == regiones[r] + 1)
+            r++;
+        uint p = regiones[r];
+
+        // posiciones inicial y final de la DMR
+        uint posicion_q = q * paso + limite_inferior;
+        uint posicion_p = p * paso + limite_inferior;
+
+        linea.append(QString::number(posicion_q));
+        linea.append("-" + QString::number(posicion_p + paso));
+
+
+        // búsqueda del nombre del GEN implicado o más cercano a los DMRs encontrados
+        //---------------------------------------------------------------------------
+        // se realiza sobre datos de la genome.ucsc.edu data base sobre genes conocidos
+        // ..previamente se han cargado los nombres y posiciones de los genes correspondientes
+        // al cromosoma que se está analizando
+        // ..por búsqueda binaria sobre este fichero se determina el nombre del gen.
+        switch (ui->genome_reference->currentIndex())
         {
-            linea.clear();
-            uint q = p;     // para ayuda en la zona de detección de referencia de genoma
-
-            // busca las posiciones inicial y final de la DMR
-            //-----------------------------------------------
-            linea.append(QString::number(posicion_dmr[p]));
+            case 0:
+                break;
 
-            while (p + 1 < dmr_diff_cols && posicion_dmr[p + 1] >= limite_inferior)
-               p++;
+            case 1:
+                int mitad        = inicio;
+                bool match       = false;
+                uint gen_ini     = 0;
+                uint gen_ant_fin = uint(stoul(cuda_data.refGen[0][4]));
 
-            linea.append("-" + QString::number(uint(posicion_dmr[p]) + paso));
+                while (uint(stoul(cuda_data.refGen[mitad][3])) < posicion_q && mitad < fin - 1)
+                    mitad++;
 
+                gen_ini = uint(stoul(cuda_data.refGen[mitad][3]));
+                if (mitad > 0)
+                    gen_ant_fin = uint(stoul(cuda_data.refGen[mitad - 1][4]));
 
-            // búsqueda del nombre del GEN implicado o más cercano a los DMRs encontrados
-            //---------------------------------------------------------------------------
-            // se realiza sobre datos de la genome.ucsc.edu data base sobre genes conocidos
-            // ..previamente se han cargado los nombres y posiciones de los genes correspondientes
-            // al cromosoma que se está analizando
-            // ..por búsqueda binaria sobre este fichero se determina el nombre del gen.
-            switch (ui->genome_reference->currentIndex())
-            {
-                case 0:
-                    break;
-
-                case 1:
-                    int mitad        = inicio;
-                    bool match       = false;
-                    uint gen_ini     = 0;
-                    uint gen_ant_fin = uint(stoul(cuda_data.refGen[0][4]));
+                // el inicio dmr es igual que inicio del gen
+                if (gen_ini == posicion_q)
+                {
+                    match = true;
+                    linea.append(" " + QString::fromStdString(cuda_data.refGen[mitad][0]) +
+                                 " " + QString::fromStdString(cuda_data.refGen[mitad][1]) +
+                                 " 0");
+                }
+                // el inicio dmr es menor que inicio del gen pero el final dmr es mayor que el inicio del gen
+                else if (gen_ini <= posicion_p + paso)
+                {
+                    match = true;
+                    linea.append(" " + QString::fromStdString(cuda_data.refGen[mitad][0]) +
+                                 " " + QString::fromStdString(cuda_data.refGen[mitad][1]) +
+                                 " -" + QString::number(stoul(cuda_data.refGen[mitad][3]) > posicion_q ?
+                                                        stoul(cuda_data.refGen[mitad][3]) - posicion_q :
+                                                        posicion_q - stoul(cuda_data.refGen[mitad][3])));
+}
+                // el inicio dmr es mayor que inicio del gen anterior pero es menor que el fin del gen anterior
+                else if (gen_ant_fin > posicion_q)
+                {
+                    match = true;
+                    linea.append(" " + QString::fromStdString(cuda_data.refGen[mitad > 0? mitad - 1 : 0][0]) +
+                                 " " + QString::fromStdString(cuda_data.refGen[mitad > 0? mitad - 1 : 0][1]) +
+                                 " +" + ((posicion_q > stoul(cuda_data.refGen[mitad > 0? mitad - 1 : 0][3])) ?
+                                        QString::number(posicion_q - stoul(cuda_data.refGen[mitad > 0? mitad - 1 : 0][3])) :
+                                        QString::number(stoul(cuda_data.refGen[mitad > 0? mitad - 1 : 0][3]) - posicion_q)));
+                }
 
-                    while (uint(stoul(cuda_data.refGen[mitad][3])) < posicion_dmr[q] && mitad < fin - 1)
-                        mitad++;
 
-                    gen_ini = uint(stoul(cuda_data.refGen[mitad][3]));
-                    if (mitad > 0)
-                        gen_ant_fin = uint(stoul(cuda_data.refGen[mitad - 1][4]));
+                // si se encuentra entre genes, ver de qué gen está más cerca
+                // se elige la distancia más pequeña entre:
+                // ..distancia inicio dmr y fin gen anterior
+                // ..distancia fin dmr e inicio gen posterior
+                if (!match)
+                {
+                    ulong dif1 = posicion_q - gen_ant_fin;
+                    ulong dif2 = gen_ini - posicion_p + paso;
 
-                    // el inicio dmr es igual que inicio del gen
-                    if (gen_ini == posicion_dmr[q])
+                    if (dif1 >= dif2)
                     {
-                        match = true;
                         linea.append(" " + QString::fromStdString(cuda_data.refGen[mitad][0]) +
                                      " " + QString::fromStdString(cuda_data.refGen[mitad][1]) +
-                                     " 0");
+                                     " --" + QString::number(dif2));
                     }
-                    // el inicio dmr es menor que inicio del gen pero el final dmr es mayor que el inicio del gen
-                    else if (gen_ini <= posicion_dmr[p] + paso)
+                    else
                     {
-                        match = true;
-                        linea.append(" " + QString::fromStdString(cuda_data.refGen[mitad][0]) +
-                                     " " + QString::fromStdString(cuda_data.refGen[mitad][1]) +
-                                     " -" + QString::number(stoul(cuda_data.refGen[mitad][3]) > posicion_dmr[q] ?
-                                                            stoul(cuda_data.refGen[mitad][3]) - posicion_dmr[q] :
-                                                            posicion_dmr[q] - stoul(cuda_data.refGen[mitad][3])));
-}
-                    // el inicio dmr es mayor que inicio del gen anterior pero es menor que el fin del gen anterior
-                    else if (gen_ant_fin > posicion_dmr[q])
-                    {
-                        match = true;
                         linea.append(" " + QString::fromStdString(cuda_data.refGen[mitad > 0? mitad - 1 : 0][0]) +
                                      " " + QString::fromStdString(cuda_data.refGen[mitad > 0? mitad - 1 : 0][1]) +
-                                     " +" + ((posicion_dmr[q] > stoul(cuda_data.refGen[mitad > 0? mitad - 1 : 0][3])) ?
-                                            QString::number(posicion_dmr[q] - stoul(cuda_data.refGen[mitad > 0? mitad - 1 : 0][3])) :
-                                            QString::number(stoul(cuda_data.refGen[mitad > 0? mitad - 1 : 0][3]) - posicion_dmr[q])));
+                                     " ++" + QString::number(dif1));
                     }
+                }
 
+                if (mitad > 0)
+                    inicio = mitad - 1;
+                break;
+        }
 
-                    // si se encuentra entre genes, ver de qué gen está más cerca
-                    // se elige la distancia más pequeña entre:
-                    // ..distancia inicio dmr y fin gen anterior
-                    // ..distancia fin dmr e inicio gen posterior
-                    if (!match)
-                    {
-                        ulong dif1 = posicion_dmr[q] - gen_ant_fin;
-                        ulong dif2 = gen_ini - posicion_dmr[p] + paso;
-
-                        if (dif1 >= dif2)
-                        {
-                            linea.append(" " + QString::fromStdString(cuda_data.refGen[mitad][0]) +
-                                         " " + QString::fromStdString(cuda_data.refGen[mitad][1]) +
-                                         " --" + QString::number(dif2));
-                        }
-                        else
-                        {
-                            linea.append(" " + QString::fromStdString(cuda_data.refGen[mitad > 0? mitad - 1 : 0][0]) +
-                                         " " + QString::fromStdString(cuda_data.refGen[mitad > 0? mitad - 1 : 0][1]) +
-                                         " ++" + QString::number(dif1));
-                        }
-                    }
-
-                    if (mitad > 0)
-                        inicio = mitad - 1;
-                    break;
-            }
 
+        // define si está hipermetilado o hipometilado el control frente al caso
+        //-----------------------------------------------------------------------
+        linea.append((dmr_diff[p] > 0)? " hiper" : " hipo");
 
-            // define si está hipermetilado o hipometilado el control frente al caso
-            //-----------------------------------------------------------------------
-            linea.append((dmr_diff[p] > 0)? " hiper" : " hipo");
+        // añade resultado de análisis DWT
+        //-----------------------------------------------------------------------
+        linea.append(" " + QString::number(double(dmr_diff[q])));
 
-            // añade resultado de análisis DWT
-            //-----------------------------------------------------------------------
-            linea.append(" " + QString::number(double(dmr_diff[q])));
-            // añade la información a la lista de DMRs
-            //-----------------------------------------------------------------------
-            ui->dmr_position->appendPlainText(linea);
+        // añade la t de Welch de la región (diferencia ponderada por la varianza de los grupos)
+        //-----------------------------------------------------------------------
+        linea.append(" " + QString::number(double(dmr_estadistica.t[q])));
+        // añade la información a la lista de DMRs
+        //-----------------------------------------------------------------------
+        ui->dmr_position->appendPlainText(linea);
 
-            // añade la información de posicion al vector de DMRs
-            //-----------------------------------------------------------------------
-            linea.append("//" + QString::number(q) + " " + QString::number(p));
-            dmrs.append(linea);
-        }
+        // añade la información de posicion al vector de DMRs
+        //-----------------------------------------------------------------------
+        linea.append("//" + QString::number(q) + " " + QString::number(p));
+        dmrs.append(linea);
     }
 
-    delete[] posicion_dmr;
-
     // selección de DMR desde listado
     qDebug() << "tamaño del fichero que guarda los dmrs localizados: " << dmrs.size() << "x" << dmrs[0].size();
     dmr_listo = true;
@@ -1959,10 +1955,10 @@ void HPG_Dhunter::hallar_dmrs()
     switch (ui->genome_reference->currentIndex())
     {
     case 0:
-        ui->label_6->setText(QString::number(dmrs.size()) + " DMRs found | range - methylation - dwt-diff (for unknown)");
+        ui->label_6->setText(QString::number(dmrs.size()) + " DMRs found | range - methylation - dwt-diff - welch-t (for unknown)");
         break;
     case 1:
-        ui->label_6->setText(QString::number(dmrs.size()) + " DMRs found | range - GENE-names - distance - methylation - dwt-diff (for " + ui->genome_reference->currentText() + ")");
+        ui->label_6->setText(QString::number(dmrs.size()) + " DMRs found | range - GENE-names - distance - methylation - dwt-diff - welch-t (for " + ui->genome_reference->currentText() + ")");
         break;
     default:
         ;
@@ -2037,9 +2033,9 @@ void HPG_Dhunter::on_dmr_position_cursorPositionChanged()
         // una línea de información por cada muestra
         for (uint j = 0; j < mc.size(); j++)
         {
-            if (int(mc[j][0][11]) == 0)
+            if (mc[j].grupo == 0)
             {
-                if (visualiza_casos.at(uint(mc[j][0][10])))
+                if (visualiza_casos.at(uint(mc[j].muestra)))
                 {
                     int cobertura_minima = 500000;
                     int cobertura_maxima = 0;
@@ -2058,41 +2054,39 @@ void HPG_Dhunter::on_dmr_position_cursorPositionChanged()
                     linea_detail.clear();
 
                     // busca la posición inical
-                    uint posicion = 0;
-                    while (pos_inf > mc[j][posicion][0])
-                        posicion++;
+                    uint posicion = uint(mc[j].busca(pos_inf));
 
                     // búsqueda de valores a lo largo del DMR
-                    while (pos_sup > mc[j][posicion][0] && posicion < mc[j].size())
+                    while (posicion < mc[j].size() && pos_sup > mc[j].posicion(posicion))
                     {
                         // cobertura
-                        if (cobertura_minima >= mc[j][posicion][ui->mC->isChecked() ? 2 : 8])
-                            cobertura_minima = int(mc[j][posicion][ui->mC->isChecked() ? 2 : 8]);
-                        if (cobertura_maxima < mc[j][posicion][ui->mC->isChecked() ? 2 : 8])
-                            cobertura_maxima = int(mc[j][posicion][ui->mC->isChecked() ? 2 : 8]);
-                        cobertura_media += mc[j][posicion][ui->mC->isChecked() ? 2 : 8];
-                        if (mc[j][posicion][ui->mC->isChecked() ? 2 : 8] > 0)
-                            ratio_medio += float(mc[j][posicion][ui->mC->isChecked() ? 1 : 7]);
+                        if (cobertura_minima >= mc[j].cobertura(posicion, !ui->mC->isChecked()))
+                            cobertura_minima = int(mc[j].cobertura(posicion, !ui->mC->isChecked()));
+                        if (cobertura_maxima < mc[j].cobertura(posicion, !ui->mC->isChecked()))
+                            cobertura_maxima = int(mc[j].cobertura(posicion, !ui->mC->isChecked()));
+                        cobertura_media += mc[j].cobertura(posicion, !ui->mC->isChecked());
+                        if (mc[j].cobertura(posicion, !ui->mC->isChecked()) > 0)
+                            ratio_medio += float(mc[j].ratio(posicion, !ui->mC->isChecked()));
 
 
                         // distancia
-                        if (posicion + 2 < mc[j].size() && ancho_dmr > mc[j][posicion + 1][0] - mc[j][posicion][0])
+                        if (posicion + 2 < mc[j].size() && ancho_dmr > mc[j].posicion(posicion + 1) - mc[j].posicion(posicion))
                         {
-                            if (distancia_minima >= mc[j][posicion + 1][0] - mc[j][posicion][0])
-                                distancia_minima = int(mc[j][posicion + 1][0] - mc[j][posicion][0]);
-                            if (distancia_maxima < mc[j][posicion + 1][0] - mc[j][posicion][0])
-                                distancia_maxima = int(mc[j][posicion + 1][0] - mc[j][posicion][0]);
-                            distancia_media += mc[j][posicion + 1][0] - mc[j][posicion][0];
+                            if (distancia_minima >= mc[j].posicion(posicion + 1) - mc[j].posicion(posicion))
+                                distancia_minima = int(mc[j].posicion(posicion + 1) - mc[j].posicion(posicion));
+                            if (distancia_maxima < mc[j].posicion(posicion + 1) - mc[j].posicion(posicion))
+                                distancia_maxima = int(mc[j].posicion(posicion + 1) - mc[j].posicion(posicion));
+                            distancia_media += mc[j].posicion(posicion + 1) - mc[j].posicion(posicion);
                         }
 
                         // número de posiciones detectadas por tipo de mononucleótico
-                        sites_C   += (mc[j][posicion][3] > 0) ? 1 : 0;
-                        sites_nC  += (mc[j][posicion][4] > 0) ? 1 : 0;
-                        sites_mC  += (mc[j][posicion][5] > 0) ? 1 : 0;
-                        sites_hmC += (mc[j][posicion][6] > 0) ? 1 : 0;
+                        sites_C   += (mc[j].C(posicion) > 0) ? 1 : 0;
+                        sites_nC  += (mc[j].nC(posicion) > 0) ? 1 : 0;
+                        sites_mC  += (mc[j].mC(posicion) > 0) ? 1 : 0;
+                        sites_hmC += (mc[j].hmC(posicion) > 0) ? 1 : 0;
 
                         // número de posiciones detectadas con algún tipo de nucleótido sensible
-                        if (mc[j][posicion][ui->mC->isChecked() ? 2 : 8] > 0)
+                        if (mc[j].cobertura(posicion, !ui->mC->isChecked()) > 0)
                             posiciones++;
 
                         posicion++;
@@ -2101,11 +2095,11 @@ void HPG_Dhunter::on_dmr_position_cursorPositionChanged()
 
                     // valor medio dwt en la región identificada
                     for (uint i = pos_dwt_ini; i <= pos_dwt_fin; i++)
-                        dwt_valor += h_haar_C[j][i];                    // (h_haar_C[f][i] / (pos_dwt_fin - pos_dwt_ini + 1));
+                        dwt_valor += h_haar_C.valor(j, i);              // (h_haar_C[f][i] / (pos_dwt_fin - pos_dwt_ini + 1));
                     dwt_valor /= (pos_dwt_fin - pos_dwt_ini + 1);
 
                     // carga de resultado en línea de texto para mostrar
-                    linea_detail.append(ficheros_case.at(int(mc[j][0][10])).split("/").back() +
+                    linea_detail.append(ficheros_case.at(mc[j].muestra).split("/").back() +
                                         " " +   QString("%1").arg(double(dwt_valor)) +
                                         " " +   QString("%1").arg(posiciones > 1 ? double(ratio_medio / posiciones) : double(ratio_medio)) +
                                         " | " + QString::number(posiciones) +
@@ -2127,9 +2121,9 @@ void HPG_Dhunter::on_dmr_position_cursorPositionChanged()
 
         for (uint j = 0; j < mc.size(); j++)
         {
-            if (int(mc[j][0][11]) == 1)
+            if (mc[j].grupo == 1)
             {
-                if (visualiza_control.at(uint(mc[j][0][10])))
+                if (visualiza_control.at(uint(mc[j].muestra)))
                 {
                     int cobertura_minima = 500000;
                     int cobertura_maxima = 0;
@@ -2148,41 +2142,39 @@ void HPG_Dhunter::on_dmr_position_cursorPositionChanged()
                     linea_detail.clear();
 
                     // busca la posición inical
-                    uint posicion = 0;
-                    while (pos_inf > mc[j][posicion][0])
-                        posicion++;
+                    uint posicion = uint(mc[j].busca(pos_inf));
 
                     // búsqueda de valores a lo largo del DMR
-                    while (pos_sup > mc[j][posicion][0] && posicion < mc[j].size())
+                    while (posicion < mc[j].size() && pos_sup > mc[j].posicion(posicion))
                     {
                         // cobertura
-                        if (cobertura_minima >= mc[j][posicion][ui->mC->isChecked() ? 2 : 8])
-                            cobertura_minima = int(mc[j][posicion][ui->mC->isChecked() ? 2 : 8]);
-                        if (cobertura_maxima < mc[j][posicion][ui->mC->isChecked() ? 2 : 8])
-                            cobertura_maxima = int(mc[j][posicion][ui->mC->isChecked() ? 2 : 8]);
-                        cobertura_media += mc[j][posicion][ui->mC->isChecked() ? 2 : 8];
-                        if (mc[j][posicion][ui->mC->isChecked() ? 2 : 8] > 0)
-                            ratio_medio += float(mc[j][posicion][ui->mC->isChecked() ? 1 : 7]);
+                        if (cobertura_minima >= mc[j].cobertura(posicion, !ui->mC->isChecked()))
+                            cobertura_minima = int(mc[j].cobertura(posicion, !ui->mC->isChecked()));
+                        if (cobertura_maxima < mc[j].cobertura(posicion, !ui->mC->isChecked()))
+                            cobertura_maxima = int(mc[j].cobertura(posicion, !ui->mC->isChecked()));
+                        cobertura_media += mc[j].cobertura(posicion, !ui->mC->isChecked());
+                        if (mc[j].cobertura(posicion, !ui->mC->isChecked()) > 0)
+                            ratio_medio += float(mc[j].ratio(posicion, !ui->mC->isChecked()));
 
 
                         // distancia
-                        if (posicion + 2 < mc[j].size() && ancho_dmr > mc[j][posicion + 1][0] - mc[j][posicion][0])
+                        if (posicion + 2 < mc[j].size() && ancho_dmr > mc[j].posicion(posicion + 1) - mc[j].posicion(posicion))
                         {
-                            if (distancia_minima >= mc[j][posicion + 1][0] - mc[j][posicion][0])
-                                distancia_minima = int(mc[j][posicion + 1][0] - mc[j][posicion][0]);
-                            if (distancia_maxima < mc[j][posicion + 1][0] - mc[j][posicion][0])
-                                distancia_maxima = int(mc[j][posicion + 1][0] - mc[j][posicion][0]);
-                            distancia_media += mc[j][posicion + 1][0] - mc[j][posicion][0];
+                            if (distancia_minima >= mc[j].posicion(posicion + 1) - mc[j].posicion(posicion))
+                                distancia_minima = int(mc[j].posicion(posicion + 1) - mc[j].posicion(posicion));
+                            if (distancia_maxima < mc[j].posicion(posicion + 1) - mc[j].posicion(posicion))
+                                distancia_maxima = int(mc[j].posicion(posicion + 1) - mc[j].posicion(posicion));
+                            distancia_media += mc[j].posicion(posicion + 1) - mc[j].posicion(posicion);
                         }
 
                         // número de posiciones detectadas por tipo de mononucleótico
-                        sites_C   += (mc[j][posicion][3] > 0) ? 1 : 0;
-                        sites_nC  += (mc[j][posicion][4] > 0) ? 1 : 0;
-                        sites_mC  += (mc[j][posicion][5] > 0) ? 1 : 0;
-                        sites_hmC += (mc[j][posicion][6] > 0) ? 1 : 0;
+                        sites_C   += (mc[j].C(posicion) > 0) ? 1 : 0;
+                        sites_nC  += (mc[j].nC(posicion) > 0) ? 1 : 0;
+                        sites_mC  += (mc[j].mC(posicion) > 0) ? 1 : 0;
+                        sites_hmC += (mc[j].hmC(posicion) > 0) ? 1 : 0;
 
                         // número de posiciones detectadas con algún tipo de nucleótido sensible
-                        if (mc[j][posicion][ui->mC->isChecked() ? 2 : 8] > 0)
+                        if (mc[j].cobertura(posicion, !ui->mC->isChecked()) > 0)
                             posiciones++;
 
                         posicion++;
@@ -2190,11 +2182,11 @@ void HPG_Dhunter::on_dmr_position_cursorPositionChanged()
 
                     // valor medio dwt en la región identificada
                     for (uint i = pos_dwt_ini; i <= pos_dwt_fin; i++)
-                        dwt_valor += h_haar_C[j][i];                    // (h_haar_C[f][i] / (pos_dwt_fin - pos_dwt_ini + 1));
+                        dwt_valor += h_haar_C.valor(j, i);              // (h_haar_C[f][i] / (pos_dwt_fin - pos_dwt_ini + 1));
                     dwt_valor /= (pos_dwt_fin - pos_dwt_ini + 1);
 
                     // carga de resultado en línea de texto para mostrar
-                    linea_detail.append(ficheros_control.at(int(mc[j][0][10])).split("/").back() +
+                    linea_detail.append(ficheros_control.at(mc[j].muestra).split("/").back() +
                                         " " +     QString("%1").arg(double(dwt_valor)) +
                                         " " +     QString("%1").arg(posiciones > 1 ? double(ratio_medio / posiciones) : double(ratio_medio)) +
                                         " | " + QString::number(posiciones) +
@@ -2336,10 +2328,10 @@ void HPG_Dhunter::on_save_dmr_list_clicked()
                 switch (ui->genome_reference->currentIndex())
                 {
                 case 0:
-                    s << "pos_init-pos_end methylation dwt_diff\n";
+                    s << "pos_init-pos_end methylation dwt_diff welch_t\n";
                     break;
                 case 1:
-                    s << "pos_init-pos_end name_1 name_2 distance methylation dwt_diff\n";
+                    s << "pos_init-pos_end name_1 name_2 distance methylation dwt_diff welch_t\n";
                     break;
                 }
 
@@ -2366,7 +2358,7 @@ void HPG_Dhunter::on_save_dmr_list_clicked()
                     for (uint j = 0; j < mc.size(); j++)
                     {
                         uint posicion = posicion_muestra[j];
-                        while (pos_inf > mc[j][posicion][0] && posicion < mc[j].size() - 1)
+                        while (posicion + 1 < mc[j].size() && pos_inf > mc[j].posicion(posicion))
                             posicion++;
                         posicion_muestra[j] = posicion;
                     }
@@ -2374,11 +2366,11 @@ void HPG_Dhunter::on_save_dmr_list_clicked()
                     // guarda información de cada fichero de la zona dmr detectada
                     for (uint j = 0; j < uint(mc.size()); j++)
                     {
-                        if (int(mc[j][0][11]) == 0)
+                        if (mc[j].grupo == 0)
                         {
-                            if (visualiza_casos.at(uint(mc[j][0][10])))
+                            if (visualiza_casos.at(uint(mc[j].muestra)))
                             {
-                                s << " " << ficheros_case.at(int(mc[j][0][10])).split("/").back() << " ";
+                                s << " " << ficheros_case.at(mc[j].muestra).split("/").back() << " ";
 
                                 int cobertura_minima = 500000000;
                                 int cobertura_maxima = 0;
@@ -2398,41 +2390,41 @@ void HPG_Dhunter::on_save_dmr_list_clicked()
 
                                 // busca la posición inical
                                 uint posicion = posicion_muestra[j];
-                            //    while (pos_inf > mc[j][posicion][0])
+                            //    while (posicion < mc[j].size() && pos_inf > mc[j].posicion(posicion))
                             //        posicion++;
                             //    posicion_muestra[j] = posicion;
 
                                 // búsqueda de valores a lo largo del DMR
-                                while (pos_sup > mc[j][posicion][0] && posicion < mc[j].size() - 2)
+                                while (posicion + 2 < mc[j].size() && pos_sup > mc[j].posicion(posicion))
                                 {
                                     // cobertura
-                                    if (cobertura_minima >= mc[j][posicion][ui->mC->isChecked() ? 2 : 8])
-                                        cobertura_minima = int(mc[j][posicion][ui->mC->isChecked() ? 2 : 8]);
-                                    if (cobertura_maxima < mc[j][posicion][ui->mC->isChecked() ? 2 : 8])
-                                        cobertura_maxima = int(mc[j][posicion][ui->mC->isChecked() ? 2 : 8]);
-                                    cobertura_media += mc[j][posicion][ui->mC->isChecked() ? 2 : 8];
-                                    if (mc[j][posicion][ui->mC->isChecked() ? 2 : 8] > 0)
-                                        ratio_medio += float(mc[j][posicion][ui->mC->isChecked() ? 1 : 7]);
+                                    if (cobertura_minima >= mc[j].cobertura(posicion, !ui->mC->isChecked()))
+                                        cobertura_minima = int(mc[j].cobertura(posicion, !ui->mC->isChecked()));
+                                    if (cobertura_maxima < mc[j].cobertura(posicion, !ui->mC->isChecked()))
+                                        cobertura_maxima = int(mc[j].cobertura(posicion, !ui->mC->isChecked()));
+                                    cobertura_media += mc[j].cobertura(posicion, !ui->mC->isChecked());
+                                    if (mc[j].cobertura(posicion, !ui->mC->isChecked()) > 0)
+                                        ratio_medio += float(mc[j].ratio(posicion, !ui->mC->isChecked()));
 
 
                                     // distancia
-                                    if (posicion + 2 < mc[j].size() && ancho_dmr > mc[j][posicion + 1][0] - mc[j][posicion][0])
+                                    if (posicion + 2 < mc[j].size() && ancho_dmr > mc[j].posicion(posicion + 1) - mc[j].posicion(posicion))
                                     {
-                                        if (distancia_minima >= mc[j][posicion + 1][0] - mc[j][posicion][0])
-                                            distancia_minima = int(mc[j][posicion + 1][0] - mc[j][posicion][0]);
-                                        if (distancia_maxima < mc[j][posicion + 1][0] - mc[j][posicion][0])
-                                            distancia_maxima = int(mc[j][posicion + 1][0] - mc[j][posicion][0]);
-                                        distancia_media += mc[j][posicion + 1][0] - mc[j][posicion][0];
+                                        if (distancia_minima >= mc[j].posicion(posicion + 1) - mc[j].posicion(posicion))
+                                            distancia_minima = int(mc[j].posicion(posicion + 1) - mc[j].posicion(posicion));
+                                        if (distancia_maxima < mc[j].posicion(posicion + 1) - mc[j].posicion(posicion))
+                                            distancia_maxima = int(mc[j].posicion(posicion + 1) - mc[j].posicion(posicion));
+                                        distancia_media += mc[j].posicion(posicion + 1) - mc[j].posicion(posicion);
                                     }
 
                                     // número de posiciones detectadas por tipo de mononucleótico
-                                    sites_C   += (mc[j][posicion][3] > 0) ? 1 : 0;
-                                    sites_nC  += (mc[j][posicion][4] > 0) ? 1 : 0;
-                                    sites_mC  += (mc[j][posicion][5] > 0) ? 1 : 0;
-                                    sites_hmC += (mc[j][posicion][6] > 0) ? 1 : 0;
+                                    sites_C   += (mc[j].C(posicion) > 0) ? 1 : 0;
+                                    sites_nC  += (mc[j].nC(posicion) > 0) ? 1 : 0;
+                                    sites_mC  += (mc[j].mC(posicion) > 0) ? 1 : 0;
+                                    sites_hmC += (mc[j].hmC(posicion) > 0) ? 1 : 0;
 
                                     // número de posiciones detectadas con algún tipo de nucleótido sensible
-                                    if (mc[j][posicion][ui->mC->isChecked() ? 2 : 8] > 0)
+                                    if (mc[j].cobertura(posicion, !ui->mC->isChecked()) > 0)
                                         posiciones++;
 
                                     posicion++;
@@ -2440,7 +2432,7 @@ void HPG_Dhunter::on_save_dmr_list_clicked()
 
                                 // valor medio dwt en la región identificada
                                 for (uint i = pos_dwt_ini; i <= pos_dwt_fin; i++)
-                                    dwt_valor += h_haar_C[j][i];                    // (h_haar_C[f][i] / (pos_dwt_fin - pos_dwt_ini + 1));
+                                    dwt_valor += h_haar_C.valor(j, i);              // (h_haar_C[f][i] / (pos_dwt_fin - pos_dwt_ini + 1));
                                 dwt_valor = pos_dwt_fin - pos_dwt_ini + 1 != 0 ? dwt_valor / (pos_dwt_fin - pos_dwt_ini + 1) : dwt_valor;
 
                                 // carga de resultado en línea de texto para mostrar
@@ -2472,11 +2464,11 @@ void HPG_Dhunter::on_save_dmr_list_clicked()
 
                     for (uint j = 0; j < uint(mc.size()); j++)
                     {
-                        if (int(mc[j][0][11]) == 1)
+                        if (mc[j].grupo == 1)
                         {
-                            if (visualiza_control.at(uint(mc[j][0][10])))
+                            if (visualiza_control.at(uint(mc[j].muestra)))
                             {
-                                s << " " << ficheros_control.at(int(mc[j][0][10])).split("/").back() << " ";
+                                s << " " << ficheros_control.at(mc[j].muestra).split("/").back() << " ";
 
                                 int cobertura_minima = 500000000;
                                 int cobertura_maxima = 0;
@@ -2496,41 +2488,41 @@ void HPG_Dhunter::on_save_dmr_list_clicked()
 
                                 // busca la posición inical
                                 uint posicion = posicion_muestra[j];
-                            //    while (pos_inf > mc[j][posicion][0])
+                            //    while (posicion < mc[j].size() && pos_inf > mc[j].posicion(posicion))
                             //        posicion++;
                             //    posicion_muestra[j] = posicion;
 
                                 // búsqueda de valores a lo largo del DMR
-                                while (pos_sup > mc[j][posicion][0] && posicion < mc[j].size() - 2)
+                                while (posicion + 2 < mc[j].size() && pos_sup > mc[j].posicion(posicion))
                                 {
                                     // cobertura
-                                    if (cobertura_minima >= mc[j][posicion][ui->mC->isChecked() ? 2 : 8])
-                                        cobertura_minima = int(mc[j][posicion][ui->mC->isChecked() ? 2 : 8]);
-                                    if (cobertura_maxima < mc[j][posicion][ui->mC->isChecked() ? 2 : 8])
-                                        cobertura_maxima = int(mc[j][posicion][ui->mC->isChecked() ? 2 : 8]);
-                                    cobertura_media += mc[j][posicion][ui->mC->isChecked() ? 2 : 8];
-                                    if (mc[j][posicion][ui->mC->isChecked() ? 2 : 8] > 0)
-                                        ratio_medio += float(mc[j][posicion][ui->mC->isChecked() ? 1 : 7]);
+                                    if (cobertura_minima >= mc[j].cobertura(posicion, !ui->mC->isChecked()))
+                                        cobertura_minima = int(mc[j].cobertura(posicion, !ui->mC->isChecked()));
+                                    if (cobertura_maxima < mc[j].cobertura(posicion, !ui->mC->isChecked()))
+                                        cobertura_maxima = int(mc[j].cobertura(posicion, !ui->mC->isChecked()));
+                                    cobertura_media += mc[j].cobertura(posicion, !ui->mC->isChecked());
+                                    if (mc[j].cobertura(posicion, !ui->mC->isChecked()) > 0)
+                                        ratio_medio += float(mc[j].ratio(posicion, !ui->mC->isChecked()));
 
 
                                     // distancia
-                                    if (posicion + 2 < mc[j].size() && ancho_dmr > mc[j][posicion + 1][0] - mc[j][posicion][0])
+                                    if (posicion + 2 < mc[j].size() && ancho_dmr > mc[j].posicion(posicion + 1) - mc[j].posicion(posicion))
                                     {
-                                        if (distancia_minima >= mc[j][posicion + 1][0] - mc[j][posicion][0])
-                                            distancia_minima = int(mc[j][posicion + 1][0] - mc[j][posicion][0]);
-                                        if (distancia_maxima < mc[j][posicion + 1][0] - mc[j][posicion][0])
-                                            distancia_maxima = int(mc[j][posicion + 1][0] - mc[j][posicion][0]);
-                                        distancia_media += mc[j][posicion + 1][0] - mc[j][posicion][0];
+                                        if (distancia_minima >= mc[j].posicion(posicion + 1) - mc[j].posicion(posicion))
+                                            distancia_minima = int(mc[j].posicion(posicion + 1) - mc[j].posicion(posicion));
+                                        if (distancia_maxima < mc[j].posicion(posicion + 1) - mc[j].posicion(posicion))
+                                            distancia_maxima = int(mc[j].posicion(posicion + 1) - mc[j].posicion(posicion));
+                                        distancia_media += mc[j].posicion(posicion + 1) - mc[j].posicion(posicion);
                                     }
 
                                     // número de posiciones detectadas por tipo de mononucleótico
-                                    sites_C   += (mc[j][posicion][3] > 0) ? 1 : 0;
-                                    sites_nC  += (mc[j][posicion][4] > 0) ? 1 : 0;
-                                    sites_mC  += (mc[j][posicion][5] > 0) ? 1 : 0;
-                                    sites_hmC += (mc[j][posicion][6] > 0) ? 1 : 0;
+                                    sites_C   += (mc[j].C(posicion) > 0) ? 1 : 0;
+                                    sites_nC  += (mc[j].nC(posicion) > 0) ? 1 : 0;
+                                    sites_mC  += (mc[j].mC(posicion) > 0) ? 1 : 0;
+                                    sites_hmC += (mc[j].hmC(posicion) > 0) ? 1 : 0;
 
                                     // número de posiciones detectadas con algún tipo de nucleótido sensible
-                                    if (mc[j][posicion][ui->mC->isChecked() ? 2 : 8] > 0)
+                                    if (mc[j].cobertura(posicion, !ui->mC->isChecked()) > 0)
                                         posiciones++;
 
                                     posicion++;
@@ -2538,7 +2530,7 @@ void HPG_Dhunter::on_save_dmr_list_clicked()
 
                                 // valor medio dwt en la región identificada
                                 for (uint i = pos_dwt_ini; i <= pos_dwt_fin; i++)
-                                    dwt_valor += h_haar_C[j][i];                    // (h_haar_C[f][i] / (pos_dwt_fin - pos_dwt_ini + 1));
+                                    dwt_valor += h_haar_C.valor(j, i);              // (h_haar_C[f][i] / (pos_dwt_fin - pos_dwt_ini + 1));
                                 dwt_valor = pos_dwt_fin - pos_dwt_ini + 1 != 0 ? dwt_valor / (pos_dwt_fin - pos_dwt_ini + 1) : dwt_valor;
 
                                 // carga de resultado en línea de texto para mostrar
@@ -2610,6 +2602,25 @@ void HPG_Dhunter::fichero_leido(int sample, int chrom, int inicio, int final)
 
 }
 
+// ************************************************************************************************
+void HPG_Dhunter::progreso_lectura(int sample, int porcentaje)
+{
+    if (sample < 0 || uint(sample) >= progreso_ficheros.size())
+        return;
+
+    progreso_ficheros[uint(sample)] = porcentaje;
+
+    // nombre de la muestra que informa del avance
+    QString nombre = (sample < ficheros_case.size()) ?
+                     ficheros_case.at(sample).split("/").back() :
+                     ficheros_control.at(sample - ficheros_case.size()).split("/").back();
+
+    ui->statusBar->showMessage("loading files... " +
+                               QString::number(count(progreso_ficheros.begin(), progreso_ficheros.end(), 100)) +
+                               " of " + QString::number(progreso_ficheros.size()) + " read  -  " +
+                               nombre + ": " + QString::number(porcentaje) + "%");
+}
+
 // ************************************************************************************************
 void HPG_Dhunter::cromosoma_leido(int chrom)
 {
@@ -2623,17 +2634,8 @@ void HPG_Dhunter::cromosoma_leido(int chrom)
     visualiza_casos.assign(uint(ficheros_case.size()), 1);
     visualiza_control.assign(uint(ficheros_control.size()), 1);
 
-    // ordena mc para que se gestione mejor en el programa
-    // ..primero los casos ordenados según la lista
-    for (uint m = 0; m < uint(ficheros_case.size()); m++)
-        for (uint i = 0; i < mc_aux.size(); i++)
-            if (uint(mc_aux[i][0][10]) == m && uint(mc_aux[i][0][11]) == 0)
-                    mc.push_back(mc_aux[i]);
-    // ..después los controles ordenados según la lista
-    for (uint m = 0; m < uint(ficheros_control.size()); m++)
-        for (uint i = 0; i < mc_aux.size(); i++)
-            if (uint(mc_aux[i][0][10]) == m && uint(mc_aux[i][0][11]) == 1)
-                    mc.push_back(mc_aux[i]);
+    // mc ya está ordenada: cada lector deja su muestra en el hueco que le corresponde según las
+    // listas, primero los casos y después los controles
 
 /*
     // AJENO A APLICACION -------------------------------------------------------
@@ -2662,12 +2664,12 @@ void HPG_Dhunter::cromosoma_leido(int chrom)
 
             for (uint m = 0; m < mc.size(); m++)
                 if (size_ok[m])
-                    if (pos_chr > mc[m][last_pos[m]][0])
-                        pos_chr = uint(mc[m][last_pos[m]][0]);
+                    if (pos_chr > mc[m].posicion(last_pos[m]))
+                        pos_chr = uint(mc[m].posicion(last_pos[m]));
 
             for (uint m = 0; m < mc.size(); m++)
                 if (size_ok[m])
-                    if (pos_chr == uint(mc[m][last_pos[m]][0]))
+                    if (pos_chr == uint(mc[m].posicion(last_pos[m])))
                     {
                         pos_coincidente[m] = 1;
                         if (last_pos[m] + 1 < mc[m].size())
@@ -2682,14 +2684,14 @@ void HPG_Dhunter::cromosoma_leido(int chrom)
             // escribe cobertura
             for (uint m = 0; m < mc.size(); m++)
                 if (size_ok[m])
-                    s << "," << (pos_coincidente[m] ? mc[m][last_pos[m]][2] : 0);
+                    s << "," << (pos_coincidente[m] ? mc[m].cobertura_mC(last_pos[m]) : 0);
                 else
                     s << "," << 0;
 
             // escribe metilación
             for (uint m = 0; m < mc.size(); m++)
                 if (size_ok[m])
-                    s << "," << (pos_coincidente[m] ? mc[m][last_pos[m]][5] : 0);
+                    s << "," << (pos_coincidente[m] ? mc[m].mC(last_pos[m]) : 0);
                 else
                     s << "," << 0;
 
@@ -2707,12 +2709,7 @@ void HPG_Dhunter::cromosoma_leido(int chrom)
     // --------------------------------------------------------------------------
 */
 
-    qDebug() << "tamaño de las matrices de datos" << mc_aux.size() << mc.size();
-
-    ui->statusBar->showMessage("chromosoma " + QString::number(chrom) + " read. Freeing temporary memory... please, wait a bit");
-
-    // elimina la matriz auxiliar
-    vector<vector<vector<double>>>().swap(mc_aux);
+    qDebug() << "tamaño de la matriz de datos" << mc.size() << "cromosoma" << chrom;
 
     // informa de carga terminada
     ui->statusBar->showMessage("files loaded at RAM memory. Please, select MIN COVERAGE and press ANALIZE SAMPLES");
@@ -2735,8 +2732,8 @@ void HPG_Dhunter::cromosoma_leido(int chrom)
     cuda_data.rango_inferior = 0;   // límite inferior ventana de datos a transformar
     cuda_data.rango_superior = 1;
 
-    // libera la memoria de la GPU
-    cuda_end(cuda_data);
+    // libera los datos del motor de transformada
+    motor->libera(cuda_data);
 }
 
 // ************************************************************************************************
@@ -40,54 +40,18 @@
 #include "ogl_graphic.h"
 #include "files_worker.h"
 #include "refgen.h"
-#include <cuda_runtime.h>
-#include <cuda.h>
-#include <chrono>
-
-// temporizadores para control de tiempos de los procesos de análisis
-#define TIMING
-
-#ifdef TIMING
-#define INIT_TIMER        auto start = std::chrono::high_resolution_clock::now();
-#define START_TIMER       start = std::chrono::high_resolution_clock::now();
-#define STOP_TIMER(name)  qDebug() << "DURACION de " << name << ": " << \
-                          std::chrono::duration_cast<std::chrono::milliseconds>( \
-                          std::chrono::high_resolution_clock::now()-start \
-                          ).count() << " ms ";
-#else
-#define INIT_TIMER
-#define START_TIMER
-#define STOP_TIMER(name)
-#endif
+#include "cohort_store.h"
+#include "haar_cpu.h"
+#include "transform_engine.h"
 
 #define DMR_THRESHOLD   0.3 // valor inicial para umbral de cálculo de DMRs
+#define LECTORES_DISCO  8   // número máximo de ficheros leídos a la vez para no saturar el disco
 
 
 
 using namespace std;
 
 
-/** ***********************************************************************************************
-  *  \brief declaración de funciones externas (en haar_vX.cu) para compilación con nvcc
-  *         funciones en GPU de cálculo de transformada y preparaadción de resultado para dibujado
-  *  \fn    void cuda_send_data(datos_cuda &)
-  *  \fn    void cuda_main(datos_cuda &)
-  *  \fn    void cuda_calculo_haar_L(datos_cuda &)
-  *  \fn    void cuda_init()
-  *  \fn    void cuda_end(datos_cuda &)
-  * ***********************************************************************************************
-  */
-//extern
-void cuda_send_data(datos_cuda &);
-//extern
-void cuda_main(datos_cuda &);
-//extern
-void cuda_calculo_haar_L(datos_cuda &);
-//extern
-void cuda_init();
-//extern
-void cuda_end(datos_cuda &);
-
 namespace Ui {
 class HPG_Dhunter;
 }
@@ -277,6 +241,21 @@ private slots:
     void on_forward_clicked();
     void on_reverse_clicked();
 
+    /** ***********************************************************************************************
+      * \fn void on_filtra_carga_clicked()
+      *  \brief Función responsable de activar el filtrado de posiciones por cobertura mínima
+      *         durante la lectura de ficheros
+      * ***********************************************************************************************
+      */
+    void on_filtra_carga_clicked();
+
+    /** ***********************************************************************************************
+      * \fn void on_comprime_memoria_clicked()
+      *  \brief Función responsable de activar la compresión en memoria de las muestras leídas
+      * ***********************************************************************************************
+      */
+    void on_comprime_memoria_clicked();
+
     /** ***********************************************************************************************
       * \fn void on_dmr_por_lote_clicked()
       *  \brief Función responsable abrir la ventana de identificación por lotes de DMRs
@@ -295,6 +274,15 @@ private slots:
       */
     void fichero_leido(int, int, int, int);
 
+    /** ***********************************************************************************************
+      * \fn void progreso_lectura(int, int)
+      *  \brief Función responsable de informar del avance de lectura de cada fichero
+      *  \param sample      muestra que se está leyendo
+      *  \param porcentaje  porcentaje del fichero leído
+      * ***********************************************************************************************
+      */
+    void progreso_lectura(int, int);
+
     /** ***********************************************************************************************
       * \fn void cromosoma_leido(int)
       *  \brief Función responsable de controlar la elctura e identificación de DMRs por cromosoma
@@ -380,6 +368,8 @@ private:
       *  \param **dmr_diff      datos de diferencias
       *  \param dmr_diff_rows   número de vectores de valores con los que busscar DMRs
       *  \param dmr_diff_cols   número de valores por vector con los que buscar DMRs por columna
+      *  \param indice_dmr      regiones ordenadas por |dmr_diff| y DMRs por umbral
+      *  \param dmr_estadistica muestras, varianza por grupo y t de Welch de cada región de dmr_diff
       *  \param dmr_listo       señal para habilitar el tratamiento de coloreado en ventana de DMRs
       *  \param hallar_dmrs()   función de cálculo de diferencias
       *  \param *cursor         puntero a la línea en la ventana de DMRs para colorear y capturar su info
@@ -391,6 +381,8 @@ private:
     float       **dmr_data;
     float       *dmr_diff;
     uint        dmr_diff_cols;
+    indice_umbral indice_dmr;
+    estadistica_dmr dmr_estadistica;
     bool        dmr_listo;
     void        hallar_dmrs();
     QTextCursor *cursor;
@@ -411,12 +403,15 @@ private:
     /** ***********************************************************************************************
       *  \brief variables para control de datos de cromosoma y hardware
       *  \param cromosoma           número de cromosoma a analizar
-      *  \param memory_available    cantidad de memoria GPU disponible en el PC para controlar capacidad
+      *  \param memory_available    cantidad de memoria del motor de transformada para controlar capacidad
+      *                             (0 si no tiene límite)
+      *  \param motor               motor de transformada (CPU o GPU)
       * ***********************************************************************************************
       */
     int cromosoma;
     int cromosoma_grid;
     int memory_available;
+    motor_transformada *motor;
 
     /** ***********************************************************************************************
       *  \brief variables para control ventanas de visualización de ficheros a analizar
@@ -433,7 +428,7 @@ private:
       *  \param primera_seleccion_control   controla los ficheros a visualizar
       *  \param visualiza_casos             guarda posiciones de muestras de casos a visualizar
       *  \param visualiza_control           guarda posiciones de muestras de control a visualizar
-      *  \param h_haar_C_distribucion       guarda muestras calculadas en GPU
+      *  \param h_haar_C_distribucion       grupo (0 casos, 1 control) de cada muestra analizada, en el orden de las filas de la cohorte
       * ***********************************************************************************************
       */
     bool             wavelet_file;
@@ -461,13 +456,13 @@ private:
 
     /** ***********************************************************************************************
       *  \brief variable con los datos de metilación, cobertura y conteo de las muestras a analizar
-      *  \param mc    datos de las muestras en matriz 3D (muestras->posicion->datos)
+      *  \param mc    datos de las muestras por columnas (muestras->columna->posicion), primero los
+      *               casos y después los controles en el orden de las listas
       * ***********************************************************************************************
       */
-    vector<vector<vector<double>>> mc;                  // matriz con posiciones entre límites de todas las muestras
-    vector<vector<vector<double>>> mc_aux;              // matriz ordenada de las muestras
-    vector<vector<float>>          h_haar_C;            // matriz con los resultados wavelet de las muestras
-    vector<vector<uint>>           posicion_metilada;   // acumula posiciones metiladas para cálculo DMR
+    vector<muestra_metilacion>     mc;                  // muestras con posiciones entre límites
+    matriz_bloques                 h_haar_C;            // matriz con los resultados wavelet de las muestras, por bloques de regiones
+    cohorte_metilacion             cohorte;             // posiciones metiladas comunes y presencia por muestra para cálculo DMR
 
     /** ***********************************************************************************************
       * \fn void dibuja()
@@ -476,16 +471,28 @@ private:
       */
     void dibuja();
 
+    /** ***********************************************************************************************
+      * \fn void avisa_filtro_carga()
+      *  \brief función responsable de avisar si el tipo de análisis seleccionado no coincide con
+      *         el utilizado para filtrar por cobertura las posiciones durante la lectura
+      * ***********************************************************************************************
+      */
+    void avisa_filtro_carga();
+
     /** ***********************************************************************************************
       *  \brief variables para control de procesos en hilos
       *  \param hilo_files_worker   vector de hilos que albergan la función de lectura y procesamiento previo
       *  \param files_worker        vector de funciones de lectura y procesamiento previo de ficheros
+      *  \param cola_lectura        ficheros pendientes de leer que toman los lectores
+      *  \param progreso_ficheros   porcentaje leído de cada fichero
       *  \param *hilo_refGen        hilo que alberga la función de lectura de genes por cromosoma
       *  \param *refgen_worker      función de lectura de genes por cromosoma
       * ***********************************************************************************************
       */
     QVector<QThread*>      hilo_files_worker;
     QVector<Files_worker*> files_worker;
+    QQueue<int>            cola_lectura;
+    vector<int>            progreso_ficheros;
     QThread               *hilo_refGen;
     RefGen                *refGen_worker;
 
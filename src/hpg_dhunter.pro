@@ -30,14 +30,35 @@ SOURCES     += main.cpp \
                ogl_graphic.cpp \
                hpg_dhunter.cpp \
     files_worker.cpp \
-    refgen.cpp
+    refgen.cpp \
+    map_parser.cpp \
+    map_cache.cpp \
+    map_gzip.cpp \
+    map_index.cpp \
+    sample_store.cpp \
+    cohort_store.cpp \
+    haar_cpu.cpp \
+    haar_simd.cpp \
+    dmr_stats.cpp \
+    transform_engine.cpp
 
 HEADERS     += \
                data_pack.h \
                ogl_graphic.h \
                hpg_dhunter.h \
     files_worker.h \
-    refgen.h
+    refgen.h \
+    map_parser.h \
+    map_cache.h \
+    map_gzip.h \
+    map_index.h \
+    sample_store.h \
+    cohort_store.h \
+    haar_cpu.h \
+    haar_simd.h \
+    dmr_stats.h \
+    paralelo.h \
+    transform_engine.h
 
 FORMS       += \
                hpg_dhunter.ui
@@ -49,9 +70,19 @@ CONFIG      += C++11
 DESTDIR      = $$system(pwd)
 OBJECTS_DIR  = $$DESTDIR/Obj
 
+# zlib for reading gzip/bgzip compressed methylation maps
+LIBS         += -lz
+
+# optional GPU transform engine, off by default so the CPU-only version builds without the CUDA
+# toolkit; enable it with "qmake CONFIG+=motor_cuda". When built in it is used if a device is
+# present, and HPG_DHUNTER_MOTOR=cpu forces the CPU engine at run time
+
 #----------------------------------------------------------------------
 #-----------------------------cuda settings----------------------------
 #----------------------------------------------------------------------
+motor_cuda {
+DEFINES      += MOTOR_CUDA
+
 # cuda sources
 CUDA_SOURCES += haar_v7.cu
 
@@ -134,6 +165,7 @@ cuda.depend_command  = $$CUDA_DIR/bin/nvcc \
 
 # tell Qt that we want add more stuff to the Makefile
 QMAKE_EXTRA_COMPILERS += cuda
+}
 
 DISTFILES += haar_v7.cu
 
@@ -0,0 +1,126 @@
+#include "map_cache.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QSaveFile>
+#include <QDebug>
+#include <cstring>
+
+#define FIRMA_CACHE   "HPGDHC01"    // identificador de fichero de caché
+#define VERSION_CACHE 1             // versión del formato de caché
+#define COLUMNAS      5             // posición, C, nC, mC, hmC
+
+/** ***********************************************************************************************
+  *  \brief cabecera del fichero de caché, seguida de las columnas de datos
+  *  \param firma           identificador de fichero de caché
+  *  \param version         versión del formato
+  *  \param columnas        número de columnas uint32 que siguen a la cabecera
+  *  \param tamanyo_fuente  tamaño en bytes del methylation_map original
+  *  \param fecha_fuente    fecha de modificación del original en ms desde epoch
+  *  \param posiciones      número de posiciones (elementos por columna)
+  * ***********************************************************************************************
+  */
+struct cabecera_cache
+{
+    char     firma[8];
+    uint32_t version;
+    uint32_t columnas;
+    int64_t  tamanyo_fuente;
+    int64_t  fecha_fuente;
+    uint64_t posiciones;
+};
+
+// ************************************************************************************************
+QString ruta_cache_mapa(const QString &fichero)
+{
+    return fichero + EXTENSION_CACHE;
+}
+
+// ************************************************************************************************
+bool lee_cache_mapa(const QString &fichero, columnas_mapa &salida)
+{
+    QFileInfo original(fichero);
+    QFile     cache(ruta_cache_mapa(fichero));
+
+    if (!original.exists() || !cache.open(QIODevice::ReadOnly))
+        return false;
+
+    qint64 bytes = cache.size();
+    cabecera_cache cabecera;
+    if (bytes < qint64(sizeof(cabecera_cache)) ||
+        cache.read(reinterpret_cast<char *>(&cabecera), sizeof(cabecera_cache)) != qint64(sizeof(cabecera_cache)))
+        return false;
+
+    // comprueba que la caché corresponde a la versión actual del fichero original
+    bool valida = memcmp(cabecera.firma, FIRMA_CACHE, sizeof(cabecera.firma)) == 0 &&
+                  cabecera.version        == VERSION_CACHE &&
+                  cabecera.columnas       == COLUMNAS &&
+                  cabecera.tamanyo_fuente == original.size() &&
+                  cabecera.fecha_fuente   == original.lastModified().toMSecsSinceEpoch() &&
+                  quint64(bytes) == sizeof(cabecera_cache) + cabecera.posiciones * COLUMNAS * sizeof(uint32_t);
+
+    if (!valida)
+    {
+        qDebug() << "caché desactualizada, se vuelve a leer el fichero: " << fichero;
+        return false;
+    }
+
+    // cada columna se lee directamente sobre su vector, sin interpretar texto
+    size_t n       = size_t(cabecera.posiciones);
+    qint64 columna = qint64(n * sizeof(uint32_t));
+    salida.posicion.resize(n);
+    salida.C.resize(n);
+    salida.nC.resize(n);
+    salida.mC.resize(n);
+    salida.hmC.resize(n);
+
+    valida = cache.read(reinterpret_cast<char *>(salida.posicion.data()), columna) == columna &&
+             cache.read(reinterpret_cast<char *>(salida.C.data()),        columna) == columna &&
+             cache.read(reinterpret_cast<char *>(salida.nC.data()),       columna) == columna &&
+             cache.read(reinterpret_cast<char *>(salida.mC.data()),       columna) == columna &&
+             cache.read(reinterpret_cast<char *>(salida.hmC.data()),      columna) == columna;
+
+    cache.close();
+
+    return valida;
+}
+
+// ************************************************************************************************
+bool escribe_cache_mapa(const QString &fichero, const columnas_mapa &sitios)
+{
+    QFileInfo original(fichero);
+    QSaveFile cache(ruta_cache_mapa(fichero));
+
+    if (!original.exists() || !cache.open(QIODevice::WriteOnly))
+    {
+        qDebug() << "no se ha podido crear la caché de: " << fichero;
+        return false;
+    }
+
+    cabecera_cache cabecera;
+    memset(&cabecera, 0, sizeof(cabecera_cache));
+    memcpy(cabecera.firma, FIRMA_CACHE, sizeof(cabecera.firma));
+    cabecera.version        = VERSION_CACHE;
+    cabecera.columnas       = COLUMNAS;
+    cabecera.tamanyo_fuente = original.size();
+    cabecera.fecha_fuente   = original.lastModified().toMSecsSinceEpoch();
+    cabecera.posiciones     = sitios.size();
+
+    qint64 columna = qint64(sitios.size() * sizeof(uint32_t));
+    bool correcto  = cache.write(reinterpret_cast<const char *>(&cabecera), sizeof(cabecera_cache)) == qint64(sizeof(cabecera_cache)) &&
+                     cache.write(reinterpret_cast<const char *>(sitios.posicion.data()), columna) == columna &&
+                     cache.write(reinterpret_cast<const char *>(sitios.C.data()),        columna) == columna &&
+                     cache.write(reinterpret_cast<const char *>(sitios.nC.data()),       columna) == columna &&
+                     cache.write(reinterpret_cast<const char *>(sitios.mC.data()),       columna) == columna &&
+                     cache.write(reinterpret_cast<const char *>(sitios.hmC.data()),      columna) == columna;
+
+    // la caché solo sustituye a la anterior si se ha escrito completa
+    if (!correcto)
+    {
+        cache.cancelWriting();
+        qDebug() << "no se ha podido escribir la caché de: " << fichero;
+        return false;
+    }
+
+    return cache.commit();
+}
@@ -0,0 +1,43 @@
+#ifndef MAP_CACHE_H
+#define MAP_CACHE_H
+
+#include <QString>
+#include "map_parser.h"
+
+// extensión del fichero binario que acompaña a cada methylation_map_<sentido>_<cromosoma>.csv
+#define EXTENSION_CACHE ".dhc"
+
+/** ***********************************************************************************************
+  * \fn QString ruta_cache_mapa(const QString &)
+  *  \brief Devuelve la ruta del fichero binario de caché asociado a un methylation_map
+  *  \param &fichero    ruta del fichero de texto original
+  * ***********************************************************************************************
+  */
+QString ruta_cache_mapa(const QString &fichero);
+
+/** ***********************************************************************************************
+  * \fn bool lee_cache_mapa(const QString &, columnas_mapa &)
+  *  \brief Carga las columnas de un methylation_map desde su caché binaria, leyendo cada columna
+  *         directamente sobre su vector en lugar de interpretar el texto. La caché solo se acepta
+  *         si su cabecera coincide con el tamaño y la fecha de modificación actuales del fichero
+  *         de texto original
+  *  \param &fichero    ruta del fichero de texto original
+  *  \param &salida     columnas donde se cargan las posiciones
+  *  \return            true si la caché existe, es válida y se ha cargado
+  * ***********************************************************************************************
+  */
+bool lee_cache_mapa(const QString &fichero, columnas_mapa &salida);
+
+/** ***********************************************************************************************
+  * \fn bool escribe_cache_mapa(const QString &, const columnas_mapa &)
+  *  \brief Guarda las columnas leídas de un methylation_map en su caché binaria: cabecera con el
+  *         tamaño y la fecha del original seguida de una columna uint32 por campo (posición, C,
+  *         nC, mC, hmC). Si el directorio no admite escritura la caché simplemente no se crea
+  *  \param &fichero    ruta del fichero de texto original
+  *  \param &sitios     columnas leídas del fichero
+  *  \return            true si la caché se ha escrito
+  * ***********************************************************************************************
+  */
+bool escribe_cache_mapa(const QString &fichero, const columnas_mapa &sitios);
+
+#endif // MAP_CACHE_H
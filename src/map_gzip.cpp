@@ -0,0 +1,308 @@
+#include "map_gzip.h"
+#include "paralelo.h"
+#include <zlib.h>
+#include <cstring>
+
+// bloques BGZF que descomprime cada hilo por lote (un bloque BGZF descomprimido ocupa hasta 64 KiB)
+#define BLOQUES_POR_HILO 256
+
+// tamaño del tramo descomprimido en cada paso de la lectura de gzip normal
+#define TRAMO_GZIP (16 * 1024 * 1024)
+
+// máximo de bytes comprimidos que se entregan a zlib de una vez (avail_in es de 32 bits)
+#define ENTRADA_MAXIMA (1024 * 1024 * 1024)
+
+/** ***********************************************************************************************
+  *  \brief bloque BGZF localizado en el fichero comprimido
+  *  \param datos       primer byte de los datos comprimidos (deflate sin cabecera)
+  *  \param bytes       tamaño de los datos comprimidos
+  *  \param crc         crc32 de los datos descomprimidos
+  *  \param descomprimido   tamaño de los datos descomprimidos
+  *  \param destino     desplazamiento del bloque descomprimido en el tramo de texto del lote
+  * ***********************************************************************************************
+  */
+struct bloque_bgzf
+{
+    const unsigned char *datos;
+    size_t   bytes;
+    uint32_t crc;
+    uint32_t descomprimido;
+    size_t   destino;
+};
+
+// ************************************************************************************************
+static uint32_t lee_u16(const unsigned char *p)
+{
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8);
+}
+
+// ************************************************************************************************
+static uint32_t lee_u32(const unsigned char *p)
+{
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+// ************************************************************************************************
+// devuelve el tamaño total del bloque BGZF que empieza en p, o cero si no es un bloque válido
+static size_t tamanyo_bloque_bgzf(const unsigned char *p, size_t disponible)
+{
+    // cabecera gzip con deflate y campo extra: ID1 ID2 CM FLG MTIME(4) XFL OS XLEN(2)
+    if (disponible < 18 || p[0] != 0x1f || p[1] != 0x8b || p[2] != 8 || !(p[3] & 4))
+        return 0;
+
+    size_t extra = lee_u16(p + 10);
+    if (12 + extra > disponible)
+        return 0;
+
+    // busca el subcampo 'BC' con el tamaño del bloque menos uno
+    size_t j = 12;
+    while (j + 4 <= 12 + extra)
+    {
+        size_t longitud = lee_u16(p + j + 2);
+        if (p[j] == 'B' && p[j + 1] == 'C' && longitud == 2 && j + 6 <= 12 + extra)
+        {
+            size_t bloque = lee_u16(p + j + 4) + 1;
+            return (bloque >= 12 + extra + 8 && bloque <= disponible) ? bloque : 0;
+        }
+        j += 4 + longitud;
+    }
+
+    return 0;
+}
+
+// ************************************************************************************************
+bool es_gzip(const char *inicio, const char *final)
+{
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(inicio);
+    return final - inicio >= 18 && p[0] == 0x1f && p[1] == 0x8b && p[2] == 8;
+}
+
+// ************************************************************************************************
+bool es_bgzf(const char *inicio, const char *final)
+{
+    return tamanyo_bloque_bgzf(reinterpret_cast<const unsigned char *>(inicio), size_t(final - inicio)) > 0;
+}
+
+// ************************************************************************************************
+// analiza las líneas completas del texto descomprimido y deja al principio del tramo la línea
+// partida que queda al final, para completarla con el siguiente tramo; en el último tramo se
+// analiza todo
+static void analiza_texto(vector<char> &texto, size_t &usado, columnas_mapa &salida, unsigned hilos, bool ultimo,
+                          const filtro_mapa *filtro)
+{
+    size_t completo = usado;
+    if (!ultimo)
+    {
+        while (completo > 0 && texto[completo - 1] != '\n')
+            completo--;
+    }
+
+    parsea_mapa_paralelo(texto.data(), texto.data() + completo, salida, hilos, filtro);
+
+    memmove(texto.data(), texto.data() + completo, usado - completo);
+    usado -= completo;
+}
+
+// ************************************************************************************************
+// descomprime en paralelo los bloques BGZF por lotes
+static bool parsea_bgzf(const char *inicio,
+                        const char *final,
+                        columnas_mapa &salida,
+                        unsigned hilos,
+                        const function<bool(size_t)> &avance,
+                        const filtro_mapa *filtro)
+{
+    const unsigned char *p   = reinterpret_cast<const unsigned char *>(inicio);
+    const unsigned char *fin = reinterpret_cast<const unsigned char *>(final);
+
+    vector<char>        texto;          // texto descomprimido del lote, precedido de la línea partida
+    size_t              usado = 0;      // bytes de texto válidos
+    vector<bloque_bgzf> lote;
+    bool                correcto = true;
+
+    while (p < fin && correcto)
+    {
+        // localiza los bloques del lote y su posición en el texto descomprimido
+        lote.clear();
+        size_t destino = usado;
+        while (p < fin && lote.size() < size_t(hilos) * BLOQUES_POR_HILO)
+        {
+            size_t bloque = tamanyo_bloque_bgzf(p, size_t(fin - p));
+            if (bloque == 0)
+            {
+                correcto = false;
+                break;
+            }
+
+            size_t extra = lee_u16(p + 10);
+            bloque_bgzf b;
+            b.datos         = p + 12 + extra;
+            b.bytes         = bloque - 12 - extra - 8;
+            b.crc           = lee_u32(p + bloque - 8);
+            b.descomprimido = lee_u32(p + bloque - 4);
+            b.destino       = destino;
+            destino        += b.descomprimido;
+
+            lote.push_back(b);
+            p += bloque;
+        }
+
+        if (texto.size() < destino)
+            texto.resize(destino);
+
+        // descomprime cada bloque en su sitio del texto, repartiendo los bloques entre hilos
+        vector<char> fallo(lote.size(), 0);
+        reparte_hilos(lote.size(), hilos, [&](size_t ini, size_t fin_lote, unsigned)
+        {
+            z_stream flujo;
+            memset(&flujo, 0, sizeof(z_stream));
+            if (inflateInit2(&flujo, -MAX_WBITS) != Z_OK)
+            {
+                for (size_t k = ini; k < fin_lote; k++)
+                    fallo[k] = 1;
+                return;
+            }
+
+            for (size_t k = ini; k < fin_lote; k++)
+            {
+                const bloque_bgzf &b = lote[k];
+                if (b.descomprimido == 0)
+                    continue;
+
+                Bytef *salida_bloque = reinterpret_cast<Bytef *>(texto.data() + b.destino);
+                inflateReset(&flujo);
+                flujo.next_in   = const_cast<Bytef *>(b.datos);
+                flujo.avail_in  = uInt(b.bytes);
+                flujo.next_out  = salida_bloque;
+                flujo.avail_out = b.descomprimido;
+
+                if (inflate(&flujo, Z_FINISH) != Z_STREAM_END ||
+                    flujo.total_out != b.descomprimido ||
+                    crc32(0L, salida_bloque, b.descomprimido) != b.crc)
+                    fallo[k] = 1;
+            }
+
+            inflateEnd(&flujo);
+        });
+
+        for (char f : fallo)
+            if (f)
+                correcto = false;
+
+        // analiza las líneas completas del lote, aunque el lote esté dañado se conservan
+        // las posiciones leídas hasta el primer bloque inválido
+        if (!correcto)
+        {
+            size_t valido = usado;
+            for (size_t k = 0; k < lote.size() && !fallo[k]; k++)
+                valido = lote[k].destino + lote[k].descomprimido;
+            usado = valido;
+            analiza_texto(texto, usado, salida, hilos, false, filtro);
+            break;
+        }
+
+        usado = destino;
+        analiza_texto(texto, usado, salida, hilos, p >= fin, filtro);
+
+        if (!avance(size_t(reinterpret_cast<const char *>(p) - inicio)))
+            return false;
+    }
+
+    return correcto;
+}
+
+// ************************************************************************************************
+// descomprime secuencialmente un fichero gzip (admite varios miembros gzip concatenados)
+static bool parsea_gzip_secuencial(const char *inicio,
+                                   const char *final,
+                                   columnas_mapa &salida,
+                                   unsigned hilos,
+                                   const function<bool(size_t)> &avance,
+                                   const filtro_mapa *filtro)
+{
+    const char  *p     = inicio;          // siguiente byte comprimido sin entregar a zlib
+    vector<char> texto(TRAMO_GZIP);
+    size_t       usado = 0;
+    bool         correcto = true;
+    bool         terminado = false;
+
+    z_stream flujo;
+    memset(&flujo, 0, sizeof(z_stream));
+    if (inflateInit2(&flujo, MAX_WBITS + 16) != Z_OK)
+        return false;
+
+    while (!terminado)
+    {
+        // entrega a zlib el siguiente trozo del fichero comprimido
+        if (flujo.avail_in == 0 && p < final)
+        {
+            size_t trozo    = (size_t(final - p) > ENTRADA_MAXIMA) ? ENTRADA_MAXIMA : size_t(final - p);
+            flujo.next_in   = reinterpret_cast<Bytef *>(const_cast<char *>(p));
+            flujo.avail_in  = uInt(trozo);
+            p              += trozo;
+        }
+
+        if (texto.size() < usado + TRAMO_GZIP)
+            texto.resize(usado + TRAMO_GZIP);
+
+        flujo.next_out  = reinterpret_cast<Bytef *>(texto.data() + usado);
+        flujo.avail_out = TRAMO_GZIP;
+
+        int estado = inflate(&flujo, Z_NO_FLUSH);
+        usado += TRAMO_GZIP - flujo.avail_out;
+
+        if (estado == Z_STREAM_END)
+        {
+            // continúa con el siguiente miembro gzip si lo hay; cualquier otro dato final
+            // (relleno de ceros, ...) se ignora
+            const char *siguiente = reinterpret_cast<const char *>(flujo.next_in);
+            size_t      resto     = flujo.avail_in + size_t(final - p);
+            if (resto > 0 && (flujo.avail_in > 0 ? es_gzip(siguiente, siguiente + flujo.avail_in)
+                                                 : es_gzip(p, final)))
+                inflateReset(&flujo);
+            else
+                terminado = true;
+        }
+        else if (estado == Z_BUF_ERROR && flujo.avail_in == 0 && p >= final)
+        {
+            // fichero truncado
+            correcto  = false;
+            terminado = true;
+        }
+        else if (estado != Z_OK && estado != Z_BUF_ERROR)
+        {
+            correcto  = false;
+            terminado = true;
+        }
+
+        // la línea partida de un fichero dañado se descarta
+        analiza_texto(texto, usado, salida, hilos, terminado && correcto, filtro);
+
+        if (!avance(size_t(p - inicio) - flujo.avail_in))
+        {
+            correcto  = false;
+            terminado = true;
+        }
+    }
+
+    inflateEnd(&flujo);
+
+    return correcto;
+}
+
+// ************************************************************************************************
+bool parsea_mapa_gzip(const char *inicio,
+                      const char *final,
+                      columnas_mapa &salida,
+                      unsigned hilos,
+                      const function<bool(size_t)> &avance,
+                      const filtro_mapa *filtro)
+{
+    if (hilos < 1)
+        hilos = 1;
+
+    if (es_bgzf(inicio, final))
+        return parsea_bgzf(inicio, final, salida, hilos, avance, filtro);
+
+    return parsea_gzip_secuencial(inicio, final, salida, hilos, avance, filtro);
+}
@@ -0,0 +1,50 @@
+#ifndef MAP_GZIP_H
+#define MAP_GZIP_H
+
+#include <functional>
+#include "map_parser.h"
+
+/** ***********************************************************************************************
+  * \fn bool es_gzip(const char *, const char *)
+  *  \brief Indica si el tramo empieza con la cabecera de un fichero gzip (incluido bgzip)
+  *  \param *inicio     primer byte del fichero
+  *  \param *final      posición siguiente al último byte del fichero
+  * ***********************************************************************************************
+  */
+bool es_gzip(const char *inicio, const char *final);
+
+/** ***********************************************************************************************
+  * \fn bool es_bgzf(const char *, const char *)
+  *  \brief Indica si el tramo empieza con un bloque BGZF (gzip por bloques de bgzip), cuya
+  *         cabecera lleva el subcampo 'BC' con el tamaño del bloque comprimido
+  *  \param *inicio     primer byte del fichero
+  *  \param *final      posición siguiente al último byte del fichero
+  * ***********************************************************************************************
+  */
+bool es_bgzf(const char *inicio, const char *final);
+
+/** ***********************************************************************************************
+  * \fn bool parsea_mapa_gzip(const char *, const char *, columnas_mapa &, unsigned, const function<bool(size_t)> &, const filtro_mapa *)
+  *  \brief Descomprime en memoria un methylation_map gzip o bgzip y analiza sus líneas con
+  *         parsea_mapa_paralelo() conforme se descomprimen, sin ficheros temporales. Los ficheros
+  *         BGZF se descomprimen por lotes de bloques, un bloque por hilo; los gzip normales se
+  *         descomprimen secuencialmente. Las líneas partidas entre lotes se completan con el
+  *         lote siguiente
+  *  \param *inicio     primer byte del fichero comprimido
+  *  \param *final      posición siguiente al último byte del fichero comprimido
+  *  \param &salida     columnas donde se añaden las posiciones leídas
+  *  \param hilos       número de hilos para descomprimir y analizar
+  *  \param &avance     función llamada tras cada lote con los bytes comprimidos consumidos;
+  *                     si devuelve false se interrumpe la lectura
+  *  \param *filtro     criterio para descartar posiciones al leerlas (nullptr: se guardan todas)
+  *  \return            false si el fichero está dañado o la lectura se ha interrumpido
+  * ***********************************************************************************************
+  */
+bool parsea_mapa_gzip(const char *inicio,
+                      const char *final,
+                      columnas_mapa &salida,
+                      unsigned hilos,
+                      const function<bool(size_t)> &avance,
+                      const filtro_mapa *filtro = nullptr);
+
+#endif // MAP_GZIP_H
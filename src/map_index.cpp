@@ -0,0 +1,164 @@
+#include "map_index.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QSaveFile>
+#include <QDebug>
+#include <algorithm>
+#include <cstring>
+
+#define FIRMA_INDICE   "HPGDHI01"   // identificador de fichero de índice
+#define VERSION_INDICE 1            // versión del formato de índice
+
+/** ***********************************************************************************************
+  *  \brief cabecera del fichero de índice, seguida de las entradas
+  *  \param firma           identificador de fichero de índice
+  *  \param version         versión del formato
+  *  \param paso            líneas del fichero entre entradas
+  *  \param tamanyo_fuente  tamaño en bytes del methylation_map original
+  *  \param fecha_fuente    fecha de modificación del original en ms desde epoch
+  *  \param entradas        número de entradas del índice
+  * ***********************************************************************************************
+  */
+struct cabecera_indice
+{
+    char     firma[8];
+    uint32_t version;
+    uint32_t paso;
+    int64_t  tamanyo_fuente;
+    int64_t  fecha_fuente;
+    uint64_t entradas;
+};
+
+// ************************************************************************************************
+bool construye_indice_mapa(const char *inicio, const char *final, vector<entrada_indice> &indice)
+{
+    const char *p         = inicio;
+    uint32_t    anterior  = 0;
+    size_t      lineas    = 0;
+    size_t      siguiente = 0;      // línea a partir de la cual se anota la siguiente entrada
+
+    indice.clear();
+
+    while (p < final)
+    {
+        const char *linea = p;
+        const char *salto = static_cast<const char *>(memchr(p, '\n', size_t(final - p)));
+        p = (salto != nullptr) ? salto + 1 : final;
+
+        // primer campo de la línea, la posición; las líneas sin posición no se indexan
+        const char *c = linea;
+        while (c < p && *c == ' ')
+            c++;
+        if (c >= p || *c < '0' || *c > '9')
+            continue;
+
+        uint32_t posicion = 0;
+        while (c < p && *c >= '0' && *c <= '9')
+        {
+            posicion = posicion * 10 + uint32_t(*c - '0');
+            c++;
+        }
+
+        if (posicion < anterior)
+            return false;
+        anterior = posicion;
+
+        if (lineas >= siguiente)
+        {
+            indice.push_back({posicion, 0, uint64_t(linea - inicio)});
+            siguiente = lineas + PASO_INDICE;
+        }
+        lineas++;
+    }
+
+    return true;
+}
+
+// ************************************************************************************************
+void tramo_region(const vector<entrada_indice> &indice, uint64_t bytes, uint32_t inicio, uint32_t final,
+                  uint64_t &desde, uint64_t &hasta)
+{
+    // desde: última entrada anterior a 'inicio', de modo que el bloque que contiene la primera
+    // posición de la región queda dentro del tramo aunque haya posiciones repetidas
+    auto primera = lower_bound(indice.begin(), indice.end(), inicio,
+                               [](const entrada_indice &e, uint32_t p) { return e.posicion < p; });
+    desde = (primera == indice.begin()) ? 0 : (primera - 1)->desplazamiento;
+
+    // hasta: primera entrada con posición posterior a 'final'
+    hasta = bytes;
+    if (final > 0)
+    {
+        auto ultima = upper_bound(indice.begin(), indice.end(), final,
+                                  [](uint32_t p, const entrada_indice &e) { return p < e.posicion; });
+        if (ultima != indice.end())
+            hasta = ultima->desplazamiento;
+    }
+
+    if (hasta < desde)
+        hasta = desde;
+}
+
+// ************************************************************************************************
+bool lee_indice_mapa(const QString &fichero, vector<entrada_indice> &indice)
+{
+    QFileInfo original(fichero);
+    QFile     datos(fichero + EXTENSION_INDICE);
+
+    if (!original.exists() || !datos.open(QIODevice::ReadOnly))
+        return false;
+
+    cabecera_indice cabecera;
+    if (datos.read(reinterpret_cast<char *>(&cabecera), sizeof(cabecera_indice)) != qint64(sizeof(cabecera_indice)))
+        return false;
+
+    // comprueba que el índice corresponde a la versión actual del fichero original
+    bool valido = memcmp(cabecera.firma, FIRMA_INDICE, sizeof(cabecera.firma)) == 0 &&
+                  cabecera.version        == VERSION_INDICE &&
+                  cabecera.tamanyo_fuente == original.size() &&
+                  cabecera.fecha_fuente   == original.lastModified().toMSecsSinceEpoch() &&
+                  quint64(datos.size()) == sizeof(cabecera_indice) + cabecera.entradas * sizeof(entrada_indice);
+
+    if (!valido)
+        return false;
+
+    indice.resize(size_t(cabecera.entradas));
+    qint64 resto = qint64(indice.size() * sizeof(entrada_indice));
+
+    return datos.read(reinterpret_cast<char *>(indice.data()), resto) == resto;
+}
+
+// ************************************************************************************************
+bool escribe_indice_mapa(const QString &fichero, const vector<entrada_indice> &indice)
+{
+    QFileInfo original(fichero);
+    QSaveFile datos(fichero + EXTENSION_INDICE);
+
+    if (!original.exists() || !datos.open(QIODevice::WriteOnly))
+    {
+        qDebug() << "no se ha podido crear el índice de: " << fichero;
+        return false;
+    }
+
+    cabecera_indice cabecera;
+    memset(&cabecera, 0, sizeof(cabecera_indice));
+    memcpy(cabecera.firma, FIRMA_INDICE, sizeof(cabecera.firma));
+    cabecera.version        = VERSION_INDICE;
+    cabecera.paso           = PASO_INDICE;
+    cabecera.tamanyo_fuente = original.size();
+    cabecera.fecha_fuente   = original.lastModified().toMSecsSinceEpoch();
+    cabecera.entradas       = indice.size();
+
+    qint64 resto   = qint64(indice.size() * sizeof(entrada_indice));
+    bool correcto  = datos.write(reinterpret_cast<const char *>(&cabecera), sizeof(cabecera_indice)) == qint64(sizeof(cabecera_indice)) &&
+                     datos.write(reinterpret_cast<const char *>(indice.data()), resto) == resto;
+
+    if (!correcto)
+    {
+        datos.cancelWriting();
+        qDebug() << "no se ha podido escribir el índice de: " << fichero;
+        return false;
+    }
+
+    return datos.commit();
+}
@@ -0,0 +1,78 @@
+#ifndef MAP_INDEX_H
+#define MAP_INDEX_H
+
+#include <QString>
+#include <vector>
+#include <cstdint>
+
+using namespace std;
+
+// extensión del índice de posiciones que acompaña a cada methylation_map_<sentido>_<cromosoma>.csv
+#define EXTENSION_INDICE ".idx"
+
+// número de líneas del fichero entre dos entradas consecutivas del índice
+#define PASO_INDICE 4096
+
+/** ***********************************************************************************************
+  *  \brief entrada del índice de un methylation_map
+  *  \param posicion        posición del cromosoma en la línea indexada
+  *  \param desplazamiento  byte del fichero en que empieza la línea indexada
+  * ***********************************************************************************************
+  */
+struct entrada_indice
+{
+    uint32_t posicion;
+    uint32_t reservado;
+    uint64_t desplazamiento;
+};
+
+/** ***********************************************************************************************
+  * \fn bool construye_indice_mapa(const char *, const char *, vector<entrada_indice> &)
+  *  \brief Recorre las líneas de un methylation_map y anota la posición y el byte de inicio de
+  *         una de cada PASO_INDICE líneas con posición. El índice solo es útil si las posiciones
+  *         del fichero están ordenadas, por lo que se comprueba el orden de todas las líneas
+  *  \param *inicio     primer carácter del fichero
+  *  \param *final      posición siguiente al último carácter del fichero
+  *  \param &indice     entradas del índice
+  *  \return            false si las posiciones del fichero no están ordenadas
+  * ***********************************************************************************************
+  */
+bool construye_indice_mapa(const char *inicio, const char *final, vector<entrada_indice> &indice);
+
+/** ***********************************************************************************************
+  * \fn void tramo_region(const vector<entrada_indice> &, uint64_t, uint32_t, uint32_t, uint64_t &, uint64_t &)
+  *  \brief Calcula el tramo de bytes del fichero que contiene todas las líneas con posición en
+  *         [inicio, final]. El tramo empieza y termina en inicio de línea
+  *  \param &indice     entradas del índice
+  *  \param bytes       tamaño del fichero
+  *  \param inicio      primera posición de la región
+  *  \param final       última posición de la región (0 hasta el final del cromosoma)
+  *  \param &desde      primer byte del tramo
+  *  \param &hasta      byte siguiente al último del tramo
+  * ***********************************************************************************************
+  */
+void tramo_region(const vector<entrada_indice> &indice, uint64_t bytes, uint32_t inicio, uint32_t final,
+                  uint64_t &desde, uint64_t &hasta);
+
+/** ***********************************************************************************************
+  * \fn bool lee_indice_mapa(const QString &, vector<entrada_indice> &)
+  *  \brief Carga el índice de un methylation_map si coincide con el tamaño y la fecha de
+  *         modificación actuales del fichero original
+  *  \param &fichero    ruta del fichero de texto original
+  *  \param &indice     entradas del índice
+  *  \return            true si el índice existe, es válido y se ha cargado
+  * ***********************************************************************************************
+  */
+bool lee_indice_mapa(const QString &fichero, vector<entrada_indice> &indice);
+
+/** ***********************************************************************************************
+  * \fn bool escribe_indice_mapa(const QString &, const vector<entrada_indice> &)
+  *  \brief Guarda el índice de un methylation_map junto al fichero original
+  *  \param &fichero    ruta del fichero de texto original
+  *  \param &indice     entradas del índice
+  *  \return            true si el índice se ha escrito
+  * ***********************************************************************************************
+  */
+bool escribe_indice_mapa(const QString &fichero, const vector<entrada_indice> &indice);
+
+#endif // MAP_INDEX_H
@@ -0,0 +1,202 @@
+#include "map_parser.h"
+#include "paralelo.h"
+#include <cstring>
+
+// número de campos numéricos por línea de un methylation_map
+#define CAMPOS_LINEA 7
+
+// tamaño mínimo de bloque por hilo en la lectura paralela (evita lanzar hilos para ficheros pequeños)
+#define BLOQUE_MINIMO (4 * 1024 * 1024)
+
+// estimación de bytes por línea para reservar memoria de las columnas antes de analizar
+#define BYTES_POR_LINEA 24
+
+// ************************************************************************************************
+void columnas_mapa::reserve(size_t n)
+{
+    posicion.reserve(n);
+    C.reserve(n);
+    nC.reserve(n);
+    mC.reserve(n);
+    hmC.reserve(n);
+}
+
+// ************************************************************************************************
+void columnas_mapa::clear()
+{
+    posicion.clear();
+    C.clear();
+    nC.clear();
+    mC.clear();
+    hmC.clear();
+}
+
+// ************************************************************************************************
+void columnas_mapa::shrink_to_fit()
+{
+    posicion.shrink_to_fit();
+    C.shrink_to_fit();
+    nC.shrink_to_fit();
+    mC.shrink_to_fit();
+    hmC.shrink_to_fit();
+}
+
+// ************************************************************************************************
+void columnas_mapa::append(const columnas_mapa &otro)
+{
+    posicion.insert(posicion.end(), otro.posicion.begin(), otro.posicion.end());
+    C.insert(C.end(), otro.C.begin(), otro.C.end());
+    nC.insert(nC.end(), otro.nC.begin(), otro.nC.end());
+    mC.insert(mC.end(), otro.mC.begin(), otro.mC.end());
+    hmC.insert(hmC.end(), otro.hmC.begin(), otro.hmC.end());
+}
+
+// ************************************************************************************************
+void filtra_mapa(columnas_mapa &sitios, const filtro_mapa &filtro)
+{
+    size_t n = 0;
+
+    for (size_t k = 0; k < sitios.size(); k++)
+        if (filtro.admite(sitios.posicion[k], sitios.C[k], sitios.nC[k], sitios.mC[k], sitios.hmC[k]))
+        {
+            sitios.posicion[n] = sitios.posicion[k];
+            sitios.C[n]        = sitios.C[k];
+            sitios.nC[n]       = sitios.nC[k];
+            sitios.mC[n]       = sitios.mC[k];
+            sitios.hmC[n]      = sitios.hmC[k];
+            n++;
+        }
+
+    sitios.posicion.resize(n);
+    sitios.C.resize(n);
+    sitios.nC.resize(n);
+    sitios.mC.resize(n);
+    sitios.hmC.resize(n);
+    sitios.shrink_to_fit();
+}
+
+// ************************************************************************************************
+size_t parsea_mapa(const char *inicio, const char *final, columnas_mapa &salida, const filtro_mapa *filtro)
+{
+    const char *p      = inicio;
+    size_t      leidas = 0;
+    uint32_t    campo[CAMPOS_LINEA];
+
+    while (p < final)
+    {
+        int n = 0;     // número de campos numéricos encontrados en la línea
+
+        // recorre los campos de la línea hasta el salto de línea
+        while (p < final && *p != '\n')
+        {
+            if (*p == ' ')
+            {
+                p++;
+                continue;
+            }
+
+            // solo los campos que empiezan por dígito tienen dato, igual que isdigit + stoi
+            if (*p >= '0' && *p <= '9')
+            {
+                uint32_t valor = 0;
+                while (p < final && *p >= '0' && *p <= '9')
+                {
+                    valor = valor * 10 + uint32_t(*p - '0');
+                    p++;
+                }
+
+                if (n < CAMPOS_LINEA)
+                    campo[n] = valor;
+                n++;
+            }
+
+            // descarta el resto del campo (sufijos, '\r', ...)
+            while (p < final && *p != ' ' && *p != '\n')
+                p++;
+        }
+
+        // salta el '\n'
+        p++;
+
+        // si la primera posición es cero no se contempla para preservar la integridad de
+        // la identificación de DMRs tal y como está definido
+        if (n >= CAMPOS_LINEA && campo[0] > 0 &&
+            (filtro == nullptr || filtro->admite(campo[0], campo[1], campo[4], campo[3], campo[6])))
+        {
+            salida.posicion.push_back(campo[0]);
+            salida.C.push_back(campo[1]);
+            salida.nC.push_back(campo[4]);
+            salida.mC.push_back(campo[3]);
+            salida.hmC.push_back(campo[6]);
+            leidas++;
+        }
+    }
+
+    return leidas;
+}
+
+// ************************************************************************************************
+// asegura capacidad para 'necesario' posiciones creciendo al menos al doble, para que las
+// llamadas sucesivas sobre la misma salida no copien las columnas en cada tramo
+static void asegura_capacidad(columnas_mapa &salida, size_t necesario)
+{
+    if (salida.posicion.capacity() < necesario)
+        salida.reserve((necesario > 2 * salida.posicion.capacity()) ? necesario : 2 * salida.posicion.capacity());
+}
+
+// ************************************************************************************************
+size_t parsea_mapa_paralelo(const char *inicio, const char *final, columnas_mapa &salida, unsigned hilos,
+                            const filtro_mapa *filtro)
+{
+    size_t bytes = size_t(final - inicio);
+
+    // limita los hilos para que cada uno analice al menos un bloque mínimo
+    if (bytes / BLOQUE_MINIMO < hilos)
+        hilos = unsigned(bytes / BLOQUE_MINIMO);
+    if (hilos <= 1)
+    {
+        // con filtro no se reserva por tamaño: la mayoría de las posiciones se pueden descartar
+        if (filtro == nullptr)
+            asegura_capacidad(salida, salida.size() + bytes / BYTES_POR_LINEA);
+        return parsea_mapa(inicio, final, salida, filtro);
+    }
+
+    // cortes del tramo en saltos de línea, para que ninguna línea quede partida entre bloques
+    vector<const char *> corte(hilos + 1, final);
+    corte[0] = inicio;
+    for (unsigned h = 1; h < hilos; h++)
+    {
+        const char *p = inicio + h * (bytes / hilos);
+        if (p < corte[h - 1])
+            p = corte[h - 1];
+
+        const char *salto = static_cast<const char *>(memchr(p, '\n', size_t(final - p)));
+        corte[h] = (salto != nullptr) ? salto + 1 : final;
+    }
+
+    // análisis de cada bloque en su hilo
+    vector<columnas_mapa> bloque(hilos);
+    reparte_hilos(hilos, hilos, [&](size_t ini, size_t fin, unsigned)
+    {
+        for (size_t b = ini; b < fin; b++)
+        {
+            if (filtro == nullptr)
+                bloque[b].reserve(size_t(corte[b + 1] - corte[b]) / BYTES_POR_LINEA);
+            parsea_mapa(corte[b], corte[b + 1], bloque[b], filtro);
+        }
+    });
+
+    // une los bloques en orden de posición
+    size_t total = 0;
+    for (auto &b : bloque)
+        total += b.size();
+
+    asegura_capacidad(salida, salida.size() + total);
+    for (auto &b : bloque)
+    {
+        salida.append(b);
+        b = columnas_mapa();
+    }
+
+    return total;
+}
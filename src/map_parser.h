@@ -0,0 +1,99 @@
+#ifndef MAP_PARSER_H
+#define MAP_PARSER_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+using namespace std;
+
+/** ***********************************************************************************************
+  *  \brief columnas de datos leídas de un fichero methylation_map_*.csv
+  *         cada posición del cromosoma ocupa el mismo índice en todas las columnas
+  *  \param posicion    posición en el cromosoma                        (campo 0 de la línea)
+  *  \param C           número de reads identificando una C metilada    (campo 1 de la línea)
+  *  \param nC          número de reads identificando una C hidroximetilada (campo 4 de la línea)
+  *  \param mC          número de reads identificando una mC            (campo 3 de la línea)
+  *  \param hmC         número de reads identificando una hmC           (campo 6 de la línea)
+  * ***********************************************************************************************
+  */
+struct columnas_mapa
+{
+    vector<uint32_t> posicion;
+    vector<uint32_t> C;
+    vector<uint32_t> nC;
+    vector<uint32_t> mC;
+    vector<uint32_t> hmC;
+
+    size_t size() const { return posicion.size(); }
+    void   reserve(size_t n);
+    void   clear();
+    void   shrink_to_fit();
+    void   append(const columnas_mapa &otro);
+};
+
+/** ***********************************************************************************************
+  *  \brief criterio para descartar posiciones durante la lectura de un methylation_map
+  *         con el mismo criterio de cobertura que se aplica al montar la matriz de análisis
+  *  \param cobertura_minima    cobertura mínima de la posición (C + mC ó nC + hmC)
+  *  \param hmC                 la cobertura se mide sobre hmC (nC + hmC) en lugar de mC (C + mC)
+  *  \param inicio              primera posición del cromosoma admitida
+  *  \param final               última posición del cromosoma admitida (0 sin límite)
+  * ***********************************************************************************************
+  */
+struct filtro_mapa
+{
+    uint32_t cobertura_minima = 0;
+    bool     hmC              = false;
+    uint32_t inicio           = 0;
+    uint32_t final            = 0;
+
+    bool admite(uint32_t posicion, uint32_t C, uint32_t nC, uint32_t mC, uint32_t hmC_) const
+    {
+        uint64_t cobertura = hmC ? uint64_t(nC) + hmC_ : uint64_t(C) + mC;
+        return cobertura >= cobertura_minima &&
+               posicion >= inicio &&
+               (final == 0 || posicion <= final);
+    }
+};
+
+/** ***********************************************************************************************
+  * \fn void filtra_mapa(columnas_mapa &, const filtro_mapa &)
+  *  \brief Elimina de las columnas las posiciones que no cumplen el filtro, conservando el orden
+  *  \param &sitios     columnas a filtrar
+  *  \param &filtro     criterio de posiciones admitidas
+  * ***********************************************************************************************
+  */
+void filtra_mapa(columnas_mapa &sitios, const filtro_mapa &filtro);
+
+/** ***********************************************************************************************
+  * \fn size_t parsea_mapa(const char *, const char *, columnas_mapa &, const filtro_mapa *)
+  *  \brief Analiza en memoria un tramo de líneas de un methylation_map sin crear objetos por línea.
+  *         Replica el criterio de lectura original: los campos se separan por espacios, solo se
+  *         consideran los campos que empiezan por dígito, se descartan las líneas con menos de
+  *         siete campos numéricos y las posiciones iguales a cero
+  *  \param *inicio     primer carácter del tramo (debe coincidir con el inicio de una línea)
+  *  \param *final      posición siguiente al último carácter del tramo
+  *  \param &salida     columnas donde se añaden las posiciones leídas
+  *  \param *filtro     criterio para descartar posiciones al leerlas (nullptr: se guardan todas)
+  *  \return            número de posiciones añadidas
+  * ***********************************************************************************************
+  */
+size_t parsea_mapa(const char *inicio, const char *final, columnas_mapa &salida, const filtro_mapa *filtro = nullptr);
+
+/** ***********************************************************************************************
+  * \fn size_t parsea_mapa_paralelo(const char *, const char *, columnas_mapa &, unsigned, const filtro_mapa *)
+  *  \brief Divide el tramo en bloques que terminan en salto de línea, analiza cada bloque en un
+  *         hilo con parsea_mapa() y une los resultados en el orden de posición del fichero
+  *  \param *inicio     primer carácter del tramo (debe coincidir con el inicio de una línea)
+  *  \param *final      posición siguiente al último carácter del tramo
+  *  \param &salida     columnas donde se añaden las posiciones leídas
+  *  \param hilos       número de hilos a utilizar
+  *  \param *filtro     criterio para descartar posiciones al leerlas (nullptr: se guardan todas)
+  *  \return            número de posiciones añadidas
+  * ***********************************************************************************************
+  */
+size_t parsea_mapa_paralelo(const char *inicio, const char *final, columnas_mapa &salida, unsigned hilos,
+                            const filtro_mapa *filtro = nullptr);
+
+#endif // MAP_PARSER_H
@@ -9,6 +9,9 @@ OGL_graphic::OGL_graphic(QWidget *parent)
     num_samples = 6;
     num_casos   = 3;
 
+    m_cudaBufHandle = nullptr;
+    motor           = nullptr;
+
     // activa el seguimiento del ratón por la ventana de la gráfica
     // generando eventos de movimiento sin nencesidad de hacer click
     setMouseTracking(true);
@@ -24,7 +27,8 @@ void OGL_graphic::initializeGL()
 {
     initializeOpenGLFunctions();
 
-    cuda_init();
+    if (motor != nullptr)
+        motor->inicia();
 
     glClearColor(1,1,1,1);      // fondo de ventana de gráfica en blanco
 //    glClearColor(0,0,0,1);      // fondo de ventana de gráfica en negro
@@ -39,8 +43,14 @@ void OGL_graphic::initializeGL()
     glBufferData(GL_ARRAY_BUFFER, sizeof(float) * uint(num_L), NULL, GL_STATIC_DRAW);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-    m_cudaBufHandle = cuda_registerBuffer(m_buf);
+    if (motor != nullptr)
+        m_cudaBufHandle = motor->registra_buffer(m_buf);
+}
 
+// ************************************************************************************************
+void OGL_graphic::setMotor(motor_transformada *value)
+{
+    motor = value;
 }
 
 // ************************************************************************************************
@@ -67,34 +77,51 @@ void OGL_graphic::paintGL()
 // ************************************************************************************************
 void OGL_graphic::registerBuffer()
 {
-    cuda_unregisterBuffer(m_cudaBufHandle);
+    if (motor != nullptr)
+        motor->desregistra_buffer(m_cudaBufHandle);
     glBindBuffer(GL_ARRAY_BUFFER, m_buf);
     glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 4 * uint(num_samples * num_L), NULL, GL_STATIC_DRAW);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
-    m_cudaBufHandle = cuda_registerBuffer(m_buf);
+    if (motor != nullptr)
+        m_cudaBufHandle = motor->registra_buffer(m_buf);
 }
 
 // ************************************************************************************************
 void OGL_graphic::mapResource(datos_cuda &cuda_data)
 {
-    cuda_data.d_glPtr = cuda_map(m_cudaBufHandle);
+    cuda_data.d_glPtr = (motor != nullptr) ? motor->mapea(m_cudaBufHandle) : nullptr;
 }
 
 // ************************************************************************************************
 void OGL_graphic::unmapResource()
 {
-    cuda_unmap(m_cudaBufHandle);
+    if (motor != nullptr)
+        motor->desmapea(m_cudaBufHandle);
 }
 
 // ************************************************************************************************
 void OGL_graphic::unregisterBuffer()
 {
-    cuda_unregisterBuffer(m_cudaBufHandle);
+    if (motor != nullptr)
+        motor->desregistra_buffer(m_cudaBufHandle);
     glBindBuffer(GL_ARRAY_BUFFER, m_buf);
     glBufferData(GL_ARRAY_BUFFER, sizeof(float), NULL, GL_STATIC_DRAW);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
+// ************************************************************************************************
+void OGL_graphic::cargaVertices(const vector<float> &vertices)
+{
+    // el VBO tiene el tamaño fijado en registerBuffer: muestras x num_L x 4
+    size_t capacidad = size_t(4 * num_samples * num_L);
+
+    makeCurrent();
+    glBindBuffer(GL_ARRAY_BUFFER, m_buf);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, GLsizeiptr(min(vertices.size(), capacidad) * sizeof(float)), vertices.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    doneCurrent();
+}
+
 // ************************************************************************************************
 void OGL_graphic::setNum_samples(int value1, int value2)
 {
@@ -5,32 +5,11 @@
 #include <QOpenGLWidget>
 #include <QOpenGLFunctions>
 #include "data_pack.h"
+#include "transform_engine.h"
 
 
 using namespace std;
 
-/** ***********************************************************************************************
-  *  \brief declaración de funciones externas para compilación con nvcc
-  *  \fn    void *cuda_registerBuffer(GLuint buf)
-  *  \fn    void cuda_unregisterBuffer(void *res)
-  *  \fn    void *cuda_map(void *res)
-  *  \fn    void cuda_unmap(void *res)
-  *  \fn    void cuda_init()
-  * ***********************************************************************************************
-  */
-//extern
-void *cuda_registerBuffer(GLuint buf);
-//extern
-void  cuda_unregisterBuffer(void *res);
-//extern
-void *cuda_map(void *res);
-//extern
-void  cuda_unmap(void *res);
-//extern
-void  cuda_init();
-
-
-
 class OGL_graphic : public QOpenGLWidget, protected QOpenGLFunctions
 {
     Q_OBJECT
@@ -46,6 +25,14 @@ public:
       */
     void initializeGL();
 
+    /** ***********************************************************************************************
+      * \fn void setMotor(motor_transformada *)
+      *  \brief Función responsable de asignar el motor de transformada que inicializa el dispositivo
+      *         y se vincula (si puede) con el VBO
+      * ***********************************************************************************************
+      */
+    void setMotor(motor_transformada *value);
+
     /** ***********************************************************************************************
       * \fn void paintGL()
       *  \brief Función responsable de dibujar cada update() con los datos residentes en la tarjeta
@@ -89,6 +76,14 @@ public:
       */
     void unregisterBuffer();
 
+    /** ***********************************************************************************************
+      * \fn void cargaVertices(const vector<float> &)
+      *  \brief Función responsable de copiar al VBO los vértices de la gráfica calculados en CPU
+      *         cuando el motor de transformada no dibuja directamente en él
+      * ***********************************************************************************************
+      */
+    void cargaVertices(const vector<float> &vertices);
+
 
 signals:
     /** ***********************************************************************************************
@@ -118,6 +113,13 @@ private:
       */
     void  *m_cudaBufHandle;
 
+    /** ***********************************************************************************************
+      *  \brief motor de transformada que genera los datos a dibujar
+      *  \param *motor  puntero al motor (propiedad de la ventana principal)
+      * ***********************************************************************************************
+      */
+    motor_transformada *motor;
+
     /** ***********************************************************************************************
       *  \brief variables enteras para almacenar características de datos a dibujar
       *  \param num_L       número de datos por cada muestra
@@ -0,0 +1,59 @@
+#ifndef PARALELO_H
+#define PARALELO_H
+
+#include <thread>
+#include <vector>
+#include <functional>
+
+using namespace std;
+
+/** ***********************************************************************************************
+  * \fn unsigned hilos_disponibles()
+  *  \brief Devuelve el número de hilos hardware del sistema (al menos uno)
+  * ***********************************************************************************************
+  */
+inline unsigned hilos_disponibles()
+{
+    unsigned hilos = thread::hardware_concurrency();
+    return (hilos > 0) ? hilos : 1;
+}
+
+/** ***********************************************************************************************
+  * \fn void reparte_hilos(size_t, unsigned, const function<void(size_t, size_t, unsigned)> &)
+  *  \brief Reparte el intervalo [0, n) en tramos contiguos, uno por hilo, ejecuta el trabajo
+  *         de cada tramo en su hilo y espera a que todos terminen. El tramo 0 lo ejecuta el
+  *         hilo que llama.
+  *  \param n       número de elementos a repartir
+  *  \param hilos   número de hilos a utilizar
+  *  \param trabajo función a ejecutar con (inicio, final, número de tramo)
+  * ***********************************************************************************************
+  */
+inline void reparte_hilos(size_t n, unsigned hilos, const function<void(size_t, size_t, unsigned)> &trabajo)
+{
+    if (hilos > n)
+        hilos = unsigned(n);
+    if (hilos <= 1)
+    {
+        if (n > 0)
+            trabajo(0, n, 0);
+        return;
+    }
+
+    vector<thread> grupo;
+    size_t tramo = (n + hilos - 1) / hilos;
+
+    for (unsigned h = 1; h < hilos; h++)
+    {
+        size_t inicio = h * tramo;
+        size_t final  = (inicio + tramo < n) ? inicio + tramo : n;
+        if (inicio < final)
+            grupo.emplace_back(trabajo, inicio, final, h);
+    }
+
+    trabajo(0, (tramo < n) ? tramo : n, 0);
+
+    for (auto &h : grupo)
+        h.join();
+}
+
+#endif // PARALELO_H
@@ -0,0 +1,204 @@
+#include "sample_store.h"
+#include <algorithm>
+#include <cstring>
+
+// bytes de relleno al final de los datos comprimidos para leer los conteos empaquetados
+// con cargas de 64 bits sin salirse del vector
+#define RELLENO 8
+
+// ************************************************************************************************
+// bits necesarios para representar 'valor'
+static uint8_t bits_valor(uint32_t valor)
+{
+    uint8_t bits = 0;
+    while (valor > 0)
+    {
+        bits++;
+        valor >>= 1;
+    }
+    return bits;
+}
+
+// ************************************************************************************************
+// empaqueta n valores de 'bits' bits a partir del final de 'datos'
+static void empaqueta(vector<uint8_t> &datos, const uint32_t *valor, size_t n, uint8_t bits)
+{
+    if (bits == 0)
+        return;
+
+    size_t inicio = datos.size();
+    datos.resize(inicio + (n * bits + 7) / 8, 0);
+
+    uint64_t acumulado = 0;         // bits pendientes de escribir
+    unsigned pendientes = 0;
+    size_t   p          = inicio;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        acumulado |= uint64_t(valor[i]) << pendientes;
+        pendientes += bits;
+        while (pendientes >= 8)
+        {
+            datos[p++] = uint8_t(acumulado);
+            acumulado >>= 8;
+            pendientes -= 8;
+        }
+    }
+    if (pendientes > 0)
+        datos[p] = uint8_t(acumulado);
+}
+
+// ************************************************************************************************
+// desempaqueta n valores de 'bits' bits que empiezan en 'p'; avanza p hasta el final del tramo
+static void desempaqueta(const uint8_t *&p, uint32_t *valor, size_t n, uint8_t bits)
+{
+    if (bits == 0)
+    {
+        memset(valor, 0, n * sizeof(uint32_t));
+        return;
+    }
+
+    uint64_t mascara = (uint64_t(1) << bits) - 1;
+    size_t   bit     = 0;
+
+    for (size_t i = 0; i < n; i++, bit += bits)
+    {
+        uint64_t palabra;
+        memcpy(&palabra, p + (bit >> 3), sizeof(uint64_t));
+        valor[i] = uint32_t((palabra >> (bit & 7)) & mascara);
+    }
+
+    p += (n * bits + 7) / 8;
+}
+
+// ************************************************************************************************
+bool columnas_comprimidas::comprime(const columnas_mapa &origen)
+{
+    bloques.clear();
+    datos.clear();
+    sitios = 0;
+
+    for (size_t k = 1; k < origen.size(); k++)
+        if (origen.posicion[k] < origen.posicion[k - 1])
+            return false;
+
+    // reserva estimada: un byte por diferencia de posición y otro por conteo
+    datos.reserve(origen.size() * 3 + RELLENO);
+
+    for (size_t inicio = 0; inicio < origen.size(); inicio += SITIOS_BLOQUE)
+    {
+        size_t n = min(size_t(SITIOS_BLOQUE), origen.size() - inicio);
+
+        bloque_comprimido bloque;
+        bloque.primera_posicion = origen.posicion[inicio];
+        bloque.ultima_posicion  = origen.posicion[inicio + n - 1];
+        bloque.desplazamiento   = datos.size();
+        bloque.sitios           = uint32_t(n);
+
+        // posiciones: diferencia con la anterior en varint (7 bits por byte)
+        for (size_t k = inicio + 1; k < inicio + n; k++)
+        {
+            uint32_t diferencia = origen.posicion[k] - origen.posicion[k - 1];
+            while (diferencia >= 0x80)
+            {
+                datos.push_back(uint8_t(diferencia | 0x80));
+                diferencia >>= 7;
+            }
+            datos.push_back(uint8_t(diferencia));
+        }
+
+        // conteos: cada columna empaquetada con los bits del máximo del bloque
+        const vector<uint32_t> *columna[4] = {&origen.C, &origen.nC, &origen.mC, &origen.hmC};
+        for (int c = 0; c < 4; c++)
+        {
+            const uint32_t *valor = columna[c]->data() + inicio;
+            bloque.bits[c] = bits_valor(*max_element(valor, valor + n));
+            empaqueta(datos, valor, n, bloque.bits[c]);
+        }
+
+        bloques.push_back(bloque);
+    }
+
+    datos.resize(datos.size() + RELLENO, 0);
+    datos.shrink_to_fit();
+    bloques.shrink_to_fit();
+    sitios = origen.size();
+
+    return true;
+}
+
+// ************************************************************************************************
+void columnas_comprimidas::descomprime(size_t b, columnas_mapa &salida) const
+{
+    const bloque_comprimido &bloque = bloques[b];
+    const uint8_t           *p      = datos.data() + bloque.desplazamiento;
+    size_t                   n      = bloque.sitios;
+
+    salida.posicion.resize(n);
+    salida.C.resize(n);
+    salida.nC.resize(n);
+    salida.mC.resize(n);
+    salida.hmC.resize(n);
+
+    // posiciones
+    uint32_t *posicion = salida.posicion.data();
+    uint32_t  actual   = bloque.primera_posicion;
+    posicion[0] = actual;
+    for (size_t k = 1; k < n; k++)
+    {
+        // la mayoría de las diferencias ocupan un solo byte
+        if (*p < 0x80)
+        {
+            actual     += *p++;
+            posicion[k] = actual;
+            continue;
+        }
+
+        uint32_t diferencia = *p & 0x7f;
+        unsigned desplaza   = 7;
+        while (*p++ & 0x80)
+        {
+            diferencia |= uint32_t(*p & 0x7f) << desplaza;
+            desplaza   += 7;
+        }
+        actual     += diferencia;
+        posicion[k] = actual;
+    }
+
+    // conteos
+    desempaqueta(p, salida.C.data(),   n, bloque.bits[0]);
+    desempaqueta(p, salida.nC.data(),  n, bloque.bits[1]);
+    desempaqueta(p, salida.mC.data(),  n, bloque.bits[2]);
+    desempaqueta(p, salida.hmC.data(), n, bloque.bits[3]);
+}
+
+// ************************************************************************************************
+bool muestra_metilacion::comprime()
+{
+    if (comprimida() || !comprimidas.comprime(sitios))
+        return false;
+
+    sitios = columnas_mapa();
+    bloque_actual = size_t(-1);
+
+    return true;
+}
+
+// ************************************************************************************************
+size_t muestra_metilacion::busca(uint32_t posicion) const
+{
+    if (!comprimida())
+        return size_t(lower_bound(sitios.posicion.begin(), sitios.posicion.end(), posicion) - sitios.posicion.begin());
+
+    // primer bloque cuya última posición alcanza la buscada
+    auto bloque = lower_bound(comprimidas.bloques.begin(), comprimidas.bloques.end(), posicion,
+                              [](const bloque_comprimido &b, uint32_t p) { return b.ultima_posicion < p; });
+    if (bloque == comprimidas.bloques.end())
+        return size();
+
+    size_t k = size_t(bloque - comprimidas.bloques.begin()) * SITIOS_BLOQUE;
+    const columnas_mapa &c = tramo(k);
+
+    return size_t(bloque - comprimidas.bloques.begin()) * SITIOS_BLOQUE +
+           size_t(lower_bound(c.posicion.begin(), c.posicion.end(), posicion) - c.posicion.begin());
+}
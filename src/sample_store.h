@@ -0,0 +1,196 @@
+#ifndef SAMPLE_STORE_H
+#define SAMPLE_STORE_H
+
+#include "map_parser.h"
+
+// número de posiciones por bloque de las columnas comprimidas
+#define SITIOS_BLOQUE 4096
+
+/** ***********************************************************************************************
+  *  \brief bloque de posiciones comprimidas: posiciones como diferencias con la anterior en
+  *         varint y conteos empaquetados con los bits justos para el máximo del bloque
+  *  \param primera_posicion    posición del primer sitio del bloque (puntero de salto)
+  *  \param ultima_posicion     posición del último sitio del bloque (puntero de salto)
+  *  \param desplazamiento      byte de los datos comprimidos en que empieza el bloque
+  *  \param sitios              número de sitios del bloque
+  *  \param bits                bits por conteo de las columnas C, nC, mC y hmC
+  * ***********************************************************************************************
+  */
+struct bloque_comprimido
+{
+    uint32_t primera_posicion;
+    uint32_t ultima_posicion;
+    uint64_t desplazamiento;
+    uint32_t sitios;
+    uint8_t  bits[4];
+};
+
+/** ***********************************************************************************************
+  *  \brief columnas de un methylation_map comprimidas por bloques de SITIOS_BLOQUE posiciones
+  *  \param bloques     cabeceras de los bloques, ordenadas por posición
+  *  \param datos       datos comprimidos de todos los bloques
+  *  \param sitios      número total de posiciones
+  * ***********************************************************************************************
+  */
+struct columnas_comprimidas
+{
+    vector<bloque_comprimido> bloques;
+    vector<uint8_t>           datos;
+    size_t                    sitios = 0;
+
+    /** ***********************************************************************************************
+      * \fn bool comprime(const columnas_mapa &)
+      *  \brief Comprime las columnas; las posiciones deben estar ordenadas de menor a mayor
+      *  \return    false si las posiciones no están ordenadas (no se comprime nada)
+      * ***********************************************************************************************
+      */
+    bool comprime(const columnas_mapa &origen);
+
+    /** ***********************************************************************************************
+      * \fn void descomprime(size_t, columnas_mapa &)
+      *  \brief Descomprime el bloque b sustituyendo el contenido de las columnas de salida
+      * ***********************************************************************************************
+      */
+    void descomprime(size_t b, columnas_mapa &salida) const;
+
+    size_t bytes() const { return datos.size() + bloques.size() * sizeof(bloque_comprimido); }
+};
+
+/** ***********************************************************************************************
+  *  \brief datos de un cromosoma de una muestra, por columnas
+  *         los datos comunes a todas las posiciones se guardan una sola vez y las proporciones
+  *         y coberturas se calculan al consultarlas a partir de los conteos leídos
+  *         las columnas pueden estar comprimidas (comprime()); en ese caso los accesos por índice
+  *         descomprimen el bloque correspondiente, por lo que conviene recorrerlas en orden o
+  *         por bloques con recorre_bloques()
+  *  \param cromosoma   cromosoma leído
+  *  \param muestra     posición de la muestra en la lista de casos o de controles
+  *  \param grupo       caso '0' o control '1'
+  *  \param sentido     forward '0', reverse '1' o mix '2'
+  *  \param sitios      posiciones y conteos de C, nC, mC y hmC de la muestra (sin comprimir)
+  *  \param comprimidas posiciones y conteos comprimidos (sitios queda vacío)
+  * ***********************************************************************************************
+  */
+struct muestra_metilacion
+{
+    int                  cromosoma = 0;
+    int                  muestra   = 0;
+    int                  grupo     = 0;
+    int                  sentido   = 0;
+    columnas_mapa        sitios;
+    columnas_comprimidas comprimidas;
+
+    bool   comprimida() const { return comprimidas.sitios > 0; }
+    size_t size()       const { return comprimida() ? comprimidas.sitios : sitios.size(); }
+    bool   empty()      const { return size() == 0; }
+    size_t bytes()      const { return comprimida() ? comprimidas.bytes() : sitios.size() * 5 * sizeof(uint32_t); }
+
+    /** ***********************************************************************************************
+      * \fn bool comprime()
+      *  \brief Comprime las columnas de la muestra y libera las columnas sin comprimir
+      *  \return    false si las posiciones no están ordenadas y la muestra queda sin comprimir
+      * ***********************************************************************************************
+      */
+    bool comprime();
+
+    /** ***********************************************************************************************
+      * \fn size_t busca(uint32_t)
+      *  \brief Devuelve el índice del primer sitio con posición mayor o igual que 'posicion'
+      *         (size() si no hay ninguno), saltando por bloques si la muestra está comprimida
+      * ***********************************************************************************************
+      */
+    size_t busca(uint32_t posicion) const;
+
+    /** ***********************************************************************************************
+      * \fn void recorre_bloques(F)
+      *  \brief Recorre las columnas por tramos contiguos llamando a f(tramo, primero), donde
+      *         'primero' es el índice del primer sitio del tramo en la muestra. Sin comprimir el
+      *         tramo son las columnas completas; comprimida, cada bloque descomprimido
+      * ***********************************************************************************************
+      */
+    template <class F>
+    void recorre_bloques(F f) const
+    {
+        if (!comprimida())
+        {
+            f(sitios, size_t(0));
+            return;
+        }
+
+        columnas_mapa tramo;
+        for (size_t b = 0; b < comprimidas.bloques.size(); b++)
+        {
+            comprimidas.descomprime(b, tramo);
+            f(static_cast<const columnas_mapa &>(tramo), b * SITIOS_BLOQUE);
+        }
+    }
+
+    // posición en el cromosoma y número de reads de cada tipo
+    uint32_t posicion(size_t k) const { const columnas_mapa &c = tramo(k); return c.posicion[k]; }
+    uint32_t C(size_t k)        const { const columnas_mapa &c = tramo(k); return c.C[k]; }
+    uint32_t nC(size_t k)       const { const columnas_mapa &c = tramo(k); return c.nC[k]; }
+    uint32_t mC(size_t k)       const { const columnas_mapa &c = tramo(k); return c.mC[k]; }
+    uint32_t hmC(size_t k)      const { const columnas_mapa &c = tramo(k); return c.hmC[k]; }
+
+    // como cobertura se suma el número de C y mC o de nC y hmC
+    double cobertura_mC(size_t k)  const { const columnas_mapa &c = tramo(k); return double(c.C[k]) + c.mC[k]; }
+    double cobertura_hmC(size_t k) const { const columnas_mapa &c = tramo(k); return double(c.nC[k]) + c.hmC[k]; }
+
+    // proporción de mC o hmC frente a la cobertura (cero sin cobertura)
+    double ratio_mC(size_t k) const
+    {
+        const columnas_mapa &c = tramo(k);
+        return proporcion(c.mC[k], double(c.C[k]) + c.mC[k]);
+    }
+
+    double ratio_hmC(size_t k) const
+    {
+        const columnas_mapa &c = tramo(k);
+        return proporcion(c.hmC[k], double(c.nC[k]) + c.hmC[k]);
+    }
+
+    // cobertura y proporción del tipo de análisis seleccionado: mC (hmC = false) o hmC
+    double cobertura(size_t k, bool hmC) const { return hmC ? cobertura_hmC(k) : cobertura_mC(k); }
+    double ratio(size_t k, bool hmC)     const { return hmC ? ratio_hmC(k) : ratio_mC(k); }
+
+    // cobertura y proporción de la posición k de un tramo de columnas
+    static double cobertura(const columnas_mapa &c, size_t k, bool hmC)
+    {
+        return hmC ? double(c.nC[k]) + c.hmC[k] : double(c.C[k]) + c.mC[k];
+    }
+
+    static double ratio(const columnas_mapa &c, size_t k, bool hmC)
+    {
+        return hmC ? proporcion(c.hmC[k], double(c.nC[k]) + c.hmC[k])
+                   : proporcion(c.mC[k],  double(c.C[k])  + c.mC[k]);
+    }
+
+    static double proporcion(uint32_t metilado, double cobertura)
+    {
+        return (cobertura > 0) ? metilado / cobertura : 0.0;
+    }
+
+private:
+    // columnas que contienen el sitio k; con la muestra comprimida descomprime su bloque (si no
+    // es el último descomprimido) y deja en k el índice dentro del bloque
+    const columnas_mapa &tramo(size_t &k) const
+    {
+        if (!comprimida())
+            return sitios;
+
+        size_t b = k / SITIOS_BLOQUE;
+        if (b != bloque_actual)
+        {
+            comprimidas.descomprime(b, descomprimido);
+            bloque_actual = b;
+        }
+        k -= b * SITIOS_BLOQUE;
+
+        return descomprimido;
+    }
+
+    mutable columnas_mapa descomprimido;            // último bloque descomprimido para accesos por índice
+    mutable size_t        bloque_actual = size_t(-1);
+};
+
+#endif // SAMPLE_STORE_H
@@ -0,0 +1,276 @@
+#include "transform_engine.h"
+#include "paralelo.h"
+#include "haar_simd.h"
+#include <QDebug>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef MOTOR_CUDA
+/** ***********************************************************************************************
+  *  \brief funciones implementadas en haar_v7.cu
+  *  \fn    int  cuda_dispositivos()
+  *  \fn    int  cuda_memoria()
+  *  \fn    void cuda_init()
+  *  \fn    void cuda_send_data(datos_cuda &)
+  *  \fn    void cuda_main(datos_cuda &)
+  *  \fn    void cuda_main_tiles(datos_cuda &)
+  *  \fn    void cuda_end(datos_cuda &)
+  *  \fn    void *cuda_registerBuffer(unsigned)
+  *  \fn    void cuda_unregisterBuffer(void *)
+  *  \fn    void *cuda_map(void *)
+  *  \fn    void cuda_unmap(void *)
+  * ***********************************************************************************************
+  */
+int   cuda_dispositivos();
+int   cuda_memoria();
+void  cuda_init();
+void  cuda_send_data(datos_cuda &);
+void  cuda_main(datos_cuda &);
+void  cuda_main_tiles(datos_cuda &);
+void  cuda_end(datos_cuda &);
+void *cuda_registerBuffer(unsigned);
+void  cuda_unregisterBuffer(void *);
+void *cuda_map(void *);
+void  cuda_unmap(void *);
+#endif
+
+// ************************************************************************************************
+void motor_transformada::coeficientes_bloques(datos_cuda &cuda_data, matriz_bloques &salida, unsigned hilos)
+{
+    vector<vector<float>> filas;
+    coeficientes(cuda_data, filas);
+
+    salida.construye(filas, size_t(cuda_data.h_haar_L[0]), hilos);
+}
+
+// ************************************************************************************************
+void motor_transformada::reserva_h_haar_C(datos_cuda &cuda_data)
+{
+    size_t filas = size_t(cuda_data.samples);
+    size_t num   = size_t(cuda_data.h_haar_L[0]);
+    bool   crece = (filas * num > h_datos.capacity() || filas > h_filas.capacity());
+
+    // TODA la memoria CONTIGUA para la matriz de muestras tranformadas
+    h_datos.resize(filas * num);
+    h_filas.resize(filas);
+    for (size_t i = 0; i < filas; i++)
+        h_filas[i] = h_datos.data() + i * num;
+
+    cuda_data.h_haar_C = h_filas.data();
+    anota(cuda_data, crece);
+}
+
+// ************************************************************************************************
+void motor_transformada::reserva_h_plot(datos_cuda &cuda_data, size_t n)
+{
+    bool crece = (n > cuda_data.h_plot.capacity());
+
+    cuda_data.h_plot.reserve(n);
+    anota(cuda_data, crece);
+}
+
+// ************************************************************************************************
+void motor_transformada::anota(const datos_cuda &cuda_data, bool crece)
+{
+    if (crece)
+        espacio.reservas++;
+    else
+        espacio.reutilizaciones++;
+
+    size_t bytes = h_datos.capacity() * sizeof(float) + h_filas.capacity() * sizeof(float *) +
+                   cuda_data.h_plot.capacity() * sizeof(float);
+    espacio.bytes = max(espacio.bytes, bytes);
+}
+
+// ************************************************************************************************
+motor_cpu::motor_cpu() :
+    matriz(nullptr),
+    hilos(hilos_disponibles())
+{
+}
+
+// ************************************************************************************************
+QString motor_cpu::nombre() const
+{
+    return "CPU (" + QString::number(hilos) + " threads, " + juego_instrucciones() + ")";
+}
+
+// ************************************************************************************************
+void motor_cpu::envia(datos_cuda &cuda_data)
+{
+    libera(cuda_data);
+
+    matriz = cuda_data.mc_csr;
+    if (matriz == nullptr)
+        return;
+
+    // suma acumulada de cada muestra para calcular cualquier ventana y nivel sin transformar
+    suma.construye(*matriz, hilos);
+
+    // pirámide de coeficientes de todos los niveles sobre el cromosoma completo
+    piramide.construye(*matriz, cuda_data.rango_superior + 1, hilos);
+
+    qDebug() << "pirámide haar desde nivel" << piramide.base << ":" << piramide.bytes() + suma.bytes() << " bytes";
+}
+
+// ************************************************************************************************
+void motor_cpu::transforma(datos_cuda &cuda_data)
+{
+    cuda_data.h_plot.clear();
+    if (matriz == nullptr)
+        return;
+
+    // coeficientes de la ventana copiados de la pirámide o como diferencias de sumas acumuladas:
+    // el coste depende del número de coeficientes a dibujar, no del ancho de la ventana
+    size_t num = size_t(cuda_data.h_haar_L[0]);
+    piramide.ventana(*matriz, suma, cuda_data.rango_inferior, cuda_data.sample_num, cuda_data.levels, ventana, hilos);
+
+    reserva_h_haar_C(cuda_data);
+    for (size_t s = 0; s < size_t(cuda_data.samples) && s < ventana.size(); s++)
+    {
+        ventana[s].resize(num, 0.0f);
+        memcpy(cuda_data.h_haar_C[s], ventana[s].data(), num * sizeof(float));
+    }
+
+    reserva_h_plot(cuda_data, ventana.size() * num * 4);
+    cuda_data.d_max[0] = prepara_dibujo(ventana, num, cuda_data.h_plot);
+}
+
+// ************************************************************************************************
+void motor_cpu::coeficientes(datos_cuda &cuda_data, vector<vector<float>> &salida)
+{
+    salida.clear();
+    if (matriz == nullptr)
+        return;
+
+    // el cromosoma completo se consulta en la pirámide (o se calcula sobre las posiciones
+    // metiladas si el nivel está por debajo de su base); cualquier otra ventana como en transforma
+    if (cuda_data.rango_inferior == 0 && cuda_data.sample_num == piramide.datos)
+        salida = piramide.coeficientes(*matriz, cuda_data.levels, hilos);
+    else
+        piramide.ventana(*matriz, suma, cuda_data.rango_inferior, cuda_data.sample_num, cuda_data.levels, salida, hilos);
+
+    // mismo número de coeficientes por muestra que el calculado en h_haar_L
+    for (auto &fila : salida)
+        fila.resize(size_t(cuda_data.h_haar_L[0]), 0.0f);
+}
+
+// ************************************************************************************************
+void motor_cpu::libera(datos_cuda &cuda_data)
+{
+    matriz = nullptr;
+    suma.clear();
+    piramide.clear();
+    vector<vector<float>>().swap(ventana);
+    vector<float>().swap(cuda_data.h_plot);
+}
+
+#ifdef MOTOR_CUDA
+/** ***********************************************************************************************
+  *  \brief motor de transformada en GPU con CUDA: la matriz completa de las muestras se forma en
+  *         la memoria de la GPU y cada ventana se transforma allí, dibujando directamente en el
+  *         buffer de OpenGL vinculado. Si la matriz completa supera la cuarta parte de la memoria
+  *         de la GPU, solo la matriz dispersa queda en GPU y cada ventana se transforma por
+  *         teselas de tamaño fijo (la gráfica se genera entonces en CPU)
+  * ***********************************************************************************************
+  */
+class motor_cuda : public motor_transformada
+{
+public:
+    QString nombre() const override
+    {
+        if (ancho_tesela > 0)
+            return "GPU (CUDA, tiles of " + QString::number(ancho_tesela) + " positions)";
+        return "GPU (CUDA)";
+    }
+
+    void inicia() override { cuda_init(); }
+    int  memoria_disponible() override { return cuda_memoria(); }
+
+    void envia(datos_cuda &cuda_data) override
+    {
+        cuda_end(cuda_data);
+
+        // la matriz completa (más auxiliares y gráfica) debe caber en la cuarta parte de la
+        // memoria; si no, teselas potencia de dos con la mitad de ese espacio para los datos
+        size_t memoria  = size_t(memoria_disponible()) * 1024 * 1024;
+        size_t columna  = size_t(cuda_data.samples) * sizeof(float);
+        size_t completa = (cuda_data.sample_num + size_t(cuda_data.data_adjust)) * columna;
+
+        ancho_tesela = 0;
+        if (memoria > 0 && completa > memoria / 4)
+        {
+            ancho_tesela = 1024;
+            while (2 * ancho_tesela * columna <= memoria / 8)
+                ancho_tesela *= 2;
+        }
+        cuda_data.ancho_tesela = ancho_tesela;
+
+        cuda_send_data(cuda_data);
+    }
+
+    void transforma(datos_cuda &cuda_data) override
+    {
+        cuda_data.h_plot.clear();
+        reserva_h_haar_C(cuda_data);
+
+        if (cuda_data.ancho_tesela == 0)
+        {
+            cuda_main(cuda_data);
+            return;
+        }
+
+        cuda_main_tiles(cuda_data);
+
+        size_t num = size_t(cuda_data.h_haar_L[0]);
+        ventana.resize(size_t(cuda_data.samples));
+        for (size_t s = 0; s < ventana.size(); s++)
+            ventana[s].assign(cuda_data.h_haar_C[s], cuda_data.h_haar_C[s] + num);
+        reserva_h_plot(cuda_data, ventana.size() * num * 4);
+        cuda_data.d_max[0] = prepara_dibujo(ventana, num, cuda_data.h_plot);
+    }
+
+    void coeficientes(datos_cuda &cuda_data, vector<vector<float>> &salida) override
+    {
+        transforma(cuda_data);
+
+        size_t num = size_t(cuda_data.h_haar_L[0]);
+        salida.resize(size_t(cuda_data.samples));
+        for (size_t s = 0; s < salida.size(); s++)
+            salida[s].assign(cuda_data.h_haar_C[s], cuda_data.h_haar_C[s] + num);
+    }
+
+    void libera(datos_cuda &cuda_data) override
+    {
+        cuda_end(cuda_data);
+        ancho_tesela = 0;
+        cuda_data.ancho_tesela = 0;
+        vector<vector<float>>().swap(ventana);
+    }
+
+    bool  comparte_buffer() const override         { return ancho_tesela == 0; }
+    void *registra_buffer(unsigned buffer) override { return cuda_registerBuffer(buffer); }
+    void  desregistra_buffer(void *res) override    { cuda_unregisterBuffer(res); }
+    void *mapea(void *res) override                 { return cuda_map(res); }
+    void  desmapea(void *res) override              { cuda_unmap(res); }
+
+private:
+    size_t                ancho_tesela = 0;     // columnas por tesela (0 sin teselas)
+    vector<vector<float>> ventana;              // coeficientes de la última ventana por teselas
+};
+#endif
+
+// ************************************************************************************************
+motor_transformada *crea_motor()
+{
+#ifdef MOTOR_CUDA
+    // HPG_DHUNTER_MOTOR=cpu fuerza el motor CPU aunque haya dispositivo
+    const char *motor = getenv("HPG_DHUNTER_MOTOR");
+    bool        cpu   = (motor != nullptr && strcmp(motor, "cpu") == 0);
+    if (!cpu && cuda_dispositivos() > 0)
+        return new motor_cuda();
+#endif
+
+    return new motor_cpu();
+}
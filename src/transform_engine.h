@@ -0,0 +1,146 @@
+#ifndef TRANSFORM_ENGINE_H
+#define TRANSFORM_ENGINE_H
+
+#include <QString>
+#include "data_pack.h"
+#include "haar_cpu.h"
+#include "dmr_stats.h"
+
+/** ***********************************************************************************************
+  *  \brief interfaz de los motores de transformada haar sobre la estructura datos_cuda
+  *         todos dejan los mismos resultados: cuda_data.h_haar_C y el valor máximo d_max[0] de
+  *         la ventana transformada y los vértices de la gráfica, escritos directamente en el
+  *         buffer de OpenGL mapeado (d_glPtr) o en cuda_data.h_plot para cargarlos después
+  * ***********************************************************************************************
+  */
+class motor_transformada
+{
+public:
+    virtual ~motor_transformada() {}
+
+    /** ***********************************************************************************************
+      * \fn QString nombre() const
+      *  \brief Nombre del motor para informar al usuario
+      * ***********************************************************************************************
+      */
+    virtual QString nombre() const = 0;
+
+    /** ***********************************************************************************************
+      * \fn void inicia()
+      *  \brief Inicializa el dispositivo del motor (se llama al crear el contexto de OpenGL)
+      * ***********************************************************************************************
+      */
+    virtual void inicia() = 0;
+
+    /** ***********************************************************************************************
+      * \fn int memoria_disponible()
+      *  \brief Memoria del dispositivo en MiB para limitar las muestras a analizar, 0 sin límite
+      * ***********************************************************************************************
+      */
+    virtual int memoria_disponible() = 0;
+
+    /** ***********************************************************************************************
+      * \fn void envia(datos_cuda &)
+      *  \brief Prepara los datos de las muestras (cuda_data.mc_csr) para transformarlos
+      * ***********************************************************************************************
+      */
+    virtual void envia(datos_cuda &cuda_data) = 0;
+
+    /** ***********************************************************************************************
+      * \fn void transforma(datos_cuda &)
+      *  \brief Transforma la ventana [rango_inferior, rango_inferior + sample_num) en el nivel
+      *         cuda_data.levels, con h_haar_L ya calculado, y genera la gráfica
+      * ***********************************************************************************************
+      */
+    virtual void transforma(datos_cuda &cuda_data) = 0;
+
+    /** ***********************************************************************************************
+      * \fn void coeficientes(datos_cuda &, vector<vector<float>> &)
+      *  \brief Coeficientes de la ventana de cuda_data para la detección de DMRs, h_haar_L[0]
+      *         por muestra
+      * ***********************************************************************************************
+      */
+    virtual void coeficientes(datos_cuda &cuda_data, vector<vector<float>> &salida) = 0;
+
+    /** ***********************************************************************************************
+      * \fn void coeficientes_bloques(datos_cuda &, matriz_bloques &, unsigned)
+      *  \brief Los mismos coeficientes que coeficientes(), dispuestos por bloques de regiones para
+      *         las reducciones entre muestras del análisis de DMRs
+      * ***********************************************************************************************
+      */
+    void coeficientes_bloques(datos_cuda &cuda_data, matriz_bloques &salida, unsigned hilos);
+
+    /** ***********************************************************************************************
+      * \fn void libera(datos_cuda &)
+      *  \brief Libera los datos de las muestras preparados con envia()
+      * ***********************************************************************************************
+      */
+    virtual void libera(datos_cuda &cuda_data) = 0;
+
+    // vínculo con el buffer de dibujo de OpenGL; sin él los vértices quedan en cuda_data.h_plot
+    virtual bool  comparte_buffer() const  { return false; }
+    virtual void *registra_buffer(unsigned) { return nullptr; }
+    virtual void  desregistra_buffer(void *) {}
+    virtual void *mapea(void *)             { return nullptr; }
+    virtual void  desmapea(void *)          {}
+
+    /** ***********************************************************************************************
+      * \fn const contadores_espacio &contadores() const
+      *  \brief Reservas, reutilizaciones y marca de agua del espacio de trabajo en CPU del motor
+      * ***********************************************************************************************
+      */
+    const contadores_espacio &contadores() const { return espacio; }
+
+protected:
+    // apunta cuda_data.h_haar_C (muestras x h_haar_L[0]) al espacio de trabajo del motor, que solo
+    // crece cuando la ventana necesita más que cualquier anterior; es válida hasta la siguiente llamada
+    void reserva_h_haar_C(datos_cuda &cuda_data);
+
+    // prepara cuda_data.h_plot para n vértices sin perder la memoria ya reservada
+    void reserva_h_plot(datos_cuda &cuda_data, size_t n);
+
+    // anota en los contadores una petición al espacio de trabajo (crece si hubo que reservar)
+    void anota(const datos_cuda &cuda_data, bool crece);
+
+    vector<float>      h_datos;         // datos de h_haar_C
+    vector<float *>    h_filas;         // punteros a cada fila de h_haar_C
+    contadores_espacio espacio = {0, 0, 0};
+};
+
+/** ***********************************************************************************************
+  *  \brief motor de transformada en CPU sobre la matriz dispersa de las muestras: pirámide de
+  *         niveles del cromosoma completo y sumas acumuladas para cualquier ventana, repartiendo
+  *         las muestras entre todos los hilos del sistema
+  * ***********************************************************************************************
+  */
+class motor_cpu : public motor_transformada
+{
+public:
+    motor_cpu();
+
+    QString nombre() const override;
+    void    inicia() override {}
+    int     memoria_disponible() override { return 0; }
+    void    envia(datos_cuda &cuda_data) override;
+    void    transforma(datos_cuda &cuda_data) override;
+    void    coeficientes(datos_cuda &cuda_data, vector<vector<float>> &salida) override;
+    void    libera(datos_cuda &cuda_data) override;
+
+private:
+    const matriz_dispersa *matriz;      // matriz de las muestras enviadas
+    indice_acumulado       suma;        // sumas acumuladas de cada muestra
+    piramide_haar          piramide;    // coeficientes de todos los niveles del cromosoma completo
+    unsigned               hilos;       // hilos de cálculo
+    vector<vector<float>>  ventana;     // coeficientes de la última ventana transformada
+};
+
+/** ***********************************************************************************************
+  * \fn motor_transformada *crea_motor()
+  *  \brief Crea el motor de transformada: CUDA si se ha compilado con MOTOR_CUDA y hay un
+  *         dispositivo, salvo que la variable de entorno HPG_DHUNTER_MOTOR valga "cpu"; en otro
+  *         caso, el motor CPU
+  * ***********************************************************************************************
+  */
+motor_transformada *crea_motor();
+
+#endif // TRANSFORM_ENGINE_H